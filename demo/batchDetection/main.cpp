@@ -0,0 +1,75 @@
+// Written by Uglješa Lukešević (github.com/ukicomputers)
+
+#include <ukicomputers/YoloNAS.hpp>
+#include <iostream>
+#include <chrono>
+using namespace std;
+
+// This is vector for already trained (by deci.ai) YOLO-NAS COCO dataset
+const vector<string> COCO_LABELS{"person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat",
+                                 "traffic light", "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat",
+                                 "dog", "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe", "backpack",
+                                 "umbrella", "handbag", "tie", "suitcase", "frisbee", "skis", "snowboard", "sports ball",
+                                 "kite", "baseball bat", "baseball glove", "skateboard", "surfboard", "tennis racket",
+                                 "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
+                                 "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair",
+                                 "couch", "potted plant", "bed", "dining table", "toilet", "tv", "laptop", "mouse",
+                                 "remote", "keyboard", "cell phone", "microwave", "oven", "toaster", "sink", "refrigerator",
+                                 "book", "clock", "vase", "scissors", "teddy bear", "hair drier", "toothbrush"};
+
+// Head directory of all models
+const string modelsPath = "../../../models/yolonas/onnx/";
+
+// Used re-defined score thereshold
+float score = 0.5;
+
+// Number of frames (e.g. cameras) processed together, and how many rounds are timed
+const int frames = 8;
+const int rounds = 10;
+
+int main()
+{
+    // Initialize time counter
+    chrono::steady_clock::time_point begin;
+    chrono::steady_clock::time_point end;
+
+    /*  Batched inference requires a model exported with dynamic batch axis,
+        models exported with fixed batch size of 1 will throw MODEL_DOES_NOT_SUPPORT_BATCH.
+    */
+
+    // Prepare YoloNAS
+    YoloNAS net(modelsPath + "yolonas_s.onnx", modelsPath + "yolonas_s_metadata", COCO_LABELS, false);
+    net.setMaxBatchSize(frames);
+    net.warmupModel();
+
+    // Prepare the same image as input of every "camera"
+    cv::Mat img = cv::imread(modelsPath + "image.jpg");
+    vector<cv::Mat> imgs(frames, img);
+
+    // Run predict over every frame, one forward pass per frame
+    begin = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (int i = 0; i < frames; i++)
+            net.predict(imgs[i], false, score);
+    end = chrono::steady_clock::now();
+    double loopMs = chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0;
+
+    // Run predictBatch over all frames, one forward pass per batch
+    begin = chrono::steady_clock::now();
+    vector<vector<YoloNAS::detectionInfo>> result;
+    for (int r = 0; r < rounds; r++)
+        result = net.predictBatch(imgs, false, score);
+    end = chrono::steady_clock::now();
+    double batchMs = chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0;
+
+    // Show throughput comparison
+    int total = frames * rounds;
+    cout << "predict loop:  " << loopMs / total << "ms/frame, " << total * 1000.0 / loopMs << " FPS" << endl;
+    cout << "predictBatch:  " << batchMs / total << "ms/frame, " << total * 1000.0 / batchMs << " FPS" << endl;
+    cout << "Speedup: " << loopMs / batchMs << "x" << endl << endl;
+
+    for (size_t i = 0; i < result.size(); i++)
+        cout << "Frame " << i << ": " << result[i].size() << " detections" << endl;
+
+    return 0;
+}
@@ -27,7 +27,7 @@ int main()
     for (int i = 0; i < result.size(); i++)
     {
         cout << "************" << endl;
-        cout << "Detected: " + result[i].label << endl;
+        cout << "Detected: " << result[i].label << endl;
         cout << "Score: " + to_string(result[i].score) << endl;
         cout << "X, Y: " + to_string(result[i].x) + ", " + to_string(result[i].y) << endl;
         cout << "W, H: " + to_string(result[i].w) + ", " + to_string(result[i].h) << endl;
@@ -67,7 +67,8 @@ int main()
         result[i].y - Y coordinate of detected object (int)
         result[i].cx - Width of detected object (int)
         result[i].cy - Height of detected object (int)
-        result[i].label - Name of detetected object (std::string)
+        result[i].classId - Index of detected object in labels (int)
+        result[i].label - Name of detetected object (const char *, valid while YoloNAS exists)
         result[i].score - Accuracy of detected object (float)
 
         (here int i is used as example for object detection sequence number)
@@ -76,7 +77,7 @@ int main()
     for (int i = 0; i < result.size(); i++)
     {
         cout << "************" << endl;
-        cout << "Detected: " + result[i].label << endl;
+        cout << "Detected: " << result[i].label << endl;
         cout << "Score: " + to_string(result[i].score) << endl;
         cout << "X, Y: " + to_string(result[i].x) + ", " + to_string(result[i].y) << endl;
         cout << "W, H: " + to_string(result[i].w) + ", " + to_string(result[i].h) << endl;
@@ -0,0 +1,105 @@
+// Written by Uglješa Lukešević (github.com/ukicomputers)
+
+#include <ukicomputers/YoloNASPipeline.hpp>
+#include <chrono>
+#include <deque>
+#include <iostream>
+using namespace std;
+
+// This is vector for already trained (by deci.ai) YOLO-NAS COCO dataset
+const vector<string> COCO_LABELS{"person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat",
+                                 "traffic light", "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat",
+                                 "dog", "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe", "backpack",
+                                 "umbrella", "handbag", "tie", "suitcase", "frisbee", "skis", "snowboard", "sports ball",
+                                 "kite", "baseball bat", "baseball glove", "skateboard", "surfboard", "tennis racket",
+                                 "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
+                                 "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair",
+                                 "couch", "potted plant", "bed", "dining table", "toilet", "tv", "laptop", "mouse",
+                                 "remote", "keyboard", "cell phone", "microwave", "oven", "toaster", "sink", "refrigerator",
+                                 "book", "clock", "vase", "scissors", "teddy bear", "hair drier", "toothbrush"};
+
+// Head directory of all models
+const string modelsPath = "../../../models/yolonas/onnx/";
+
+// Used re-defined score thereshold
+float score = 0.5;
+
+// Number of frames in flight before the oldest result is shown
+const size_t depth = 3;
+
+int main()
+{
+    // Prepare YoloNAS
+    YoloNAS net(modelsPath + "yolonas_s.onnx", modelsPath + "yolonas_s_metadata", COCO_LABELS, false);
+    net.warmupModel();
+
+    /*  YoloNASPipeline class argument requirements:
+            YoloNAS (used only by pipeline while it is running),
+            queue size between stages (size_t),
+            overflow policy (BLOCK waits for space, DROP_OLDEST drops oldest waiting frame for live feeds),
+            overlay on image (bool),
+            score thereshold (float)
+    */
+    YoloNASPipeline pipeline(net, 2, YoloNASPipeline::DROP_OLDEST, true, score);
+
+    // Make an capture (currently from file, you can also use and camera source, just insert it's ID)
+    cv::VideoCapture cap(modelsPath + "street.mp4");
+
+    // If we cannot open capture, we are returning an error
+    if (!cap.isOpened())
+    {
+        cerr << "capture not open" << endl;
+        return (-1);
+    }
+
+    // Frames in flight, results come in the same order as frames were submitted
+    deque<pair<cv::Mat, future<vector<YoloNAS::detectionInfo>>>> inFlight;
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    int shown = 0;
+    bool quit = false;
+
+    while (!quit)
+    {
+        // Get the current image, every frame needs its own buffer as pipeline keeps it
+        cv::Mat frame;
+        cap >> frame;
+
+        if (!frame.empty())
+            inFlight.push_back(make_pair(frame, pipeline.submit(frame)));
+
+        // Show the oldest result when pipeline is full, or everything left at the end of the video
+        while (!inFlight.empty() && (inFlight.size() > depth || frame.empty()))
+        {
+            try
+            {
+                inFlight.front().second.get();
+                shown++;
+
+                float fps = shown * 1000.0 / chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - begin).count();
+                cv::putText(inFlight.front().first, "FPS: " + to_string(int(fps)), cv::Point(20, 40), cv::FONT_HERSHEY_DUPLEX, 0.75, cv::Scalar(255, 255, 0));
+                cv::imshow("detection", inFlight.front().first);
+
+                // If pressed ESC, close the program
+                if ((char)cv::waitKey(1) == 27)
+                    quit = true;
+            }
+            catch (runtime_error &ex)
+            {
+                // Frame was dropped, as pipeline could not keep up with the source
+            }
+
+            inFlight.pop_front();
+        }
+
+        if (frame.empty())
+            break;
+    }
+
+    pipeline.stop();
+    cout << "Shown: " << shown << ", dropped: " << pipeline.droppedFrames() << endl;
+
+    // Release the capture
+    cap.release();
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Written by Uglješa Lukešević (github.com/ukicomputers)
+
+#include <ukicomputers/Postprocessor.hpp>
+#include <opencv2/dnn.hpp>
+#include <iostream>
+#include <chrono>
+using namespace std;
+
+// Head directory of all models
+const string modelsPath = "../../../models/yolonas/onnx/";
+
+// Recorded raw output tensors, created on first run
+const string recordPath = "raw_outputs.yml.gz";
+
+// Thresholds used by YOLO-NAS S COCO model
+float score = 0.5;
+float iou = 0.7;
+
+const int iterations = 1000;
+
+// Previous postprocessing, minMaxLoc per anchor and cv::dnn::NMSBoxes
+void legacyPostprocessing(cv::Mat rawScores, cv::Mat bboxes, vector<cv::Rect> &boxes, vector<float> &scores, vector<int> &keep)
+{
+    boxes.clear();
+    scores.clear();
+    keep.clear();
+
+    bboxes.convertTo(bboxes, CV_32S);
+    for (int i = 0; i < bboxes.rows; i++)
+    {
+        double maxScore;
+        cv::Point classID;
+        cv::minMaxLoc(rawScores.row(i), 0, &maxScore, 0, &classID);
+
+        if ((float)maxScore < score)
+            continue;
+
+        vector<int> box{bboxes.at<int>(i, 0), bboxes.at<int>(i, 1), bboxes.at<int>(i, 2), bboxes.at<int>(i, 3)};
+        scores.push_back(maxScore);
+        boxes.push_back(cv::Rect(box[0], box[1], box[2] - box[0], box[3] - box[1]));
+    }
+
+    cv::dnn::NMSBoxes(boxes, scores, score, iou, keep);
+}
+
+int main()
+{
+    cv::Mat rawScores, bboxes;
+
+    // Record raw outputs of the model once, later runs only read them
+    cv::FileStorage fs(recordPath, cv::FileStorage::READ);
+    if (fs.isOpened())
+    {
+        fs["scores"] >> rawScores;
+        fs["bboxes"] >> bboxes;
+        fs.release();
+    }
+    else
+    {
+        cv::dnn::Net net = cv::dnn::readNetFromONNX(modelsPath + "yolonas_s.onnx");
+        cv::Mat blob = cv::dnn::blobFromImage(cv::imread(modelsPath + "image.jpg"), 1.0 / 255, cv::Size(640, 640), cv::Scalar(), true, false);
+
+        vector<vector<cv::Mat>> outDet;
+        net.setInput(blob);
+        net.forward(outDet, net.getUnconnectedOutLayersNames());
+
+        rawScores = outDet[0][0];
+        bboxes = outDet[1][0];
+
+        cv::FileStorage out(recordPath, cv::FileStorage::WRITE);
+        out << "scores" << rawScores;
+        out << "bboxes" << bboxes;
+        out.release();
+    }
+
+    // Tensors are [1, anchors, classes] and [1, anchors, 4]
+    int anchors = rawScores.size[1], classes = rawScores.size[2];
+    cv::Mat scores2D(anchors, classes, CV_32F, rawScores.ptr<float>());
+    cv::Mat bboxes2D(anchors, 4, CV_32F, bboxes.ptr<float>());
+
+    chrono::steady_clock::time_point begin;
+    chrono::steady_clock::time_point end;
+
+    vector<cv::Rect> boxes;
+    vector<float> scores;
+    vector<int> labels, keep;
+
+    // Previous implementation
+    begin = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        legacyPostprocessing(scores2D, bboxes2D, boxes, scores, keep);
+    end = chrono::steady_clock::now();
+    double legacyUs = chrono::duration_cast<chrono::nanoseconds>(end - begin).count() / 1000.0 / iterations;
+    size_t legacyKept = keep.size();
+
+    // Vectorized implementation
+    Postprocessor postprocessor;
+    begin = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        postprocessor.run(scores2D.ptr<float>(), bboxes2D.ptr<float>(), anchors, classes, score, iou, boxes, labels, scores, keep);
+    end = chrono::steady_clock::now();
+    double fastUs = chrono::duration_cast<chrono::nanoseconds>(end - begin).count() / 1000.0 / iterations;
+
+    cout << "Anchors: " << anchors << ", classes: " << classes << endl;
+    cout << "Legacy:        " << legacyUs << "us/frame, " << legacyKept << " detections" << endl;
+    cout << "Postprocessor: " << fastUs << "us/frame, " << keep.size() << " detections" << endl;
+    cout << "Speedup: " << legacyUs / fastUs << "x" << endl;
+
+    return 0;
+}
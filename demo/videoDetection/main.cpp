@@ -1,6 +1,8 @@
 // Written by Uglješa Lukešević (github.com/ukicomputers)
 
 #include <ukicomputers/YoloNAS.hpp>
+#include <ukicomputers/YoloNASStream.hpp>
+#include <ukicomputers/OverlayRenderer.hpp>
 #include <chrono>
 #include <cmath>
 #include <iostream>
@@ -27,6 +29,10 @@ float score = 0.5;
 // Write video
 bool writeVideo = true;
 
+// Run full detection every Nth frame (1 detects every frame), or earlier when the scene moves more than motion thereshold
+int detectEvery = 3;
+float motion = 0.05;
+
 int main()
 {
     // Initialize time counter
@@ -47,6 +53,14 @@ int main()
     YoloNAS net(modelsPath + "yolonas_s.onnx", modelsPath + "yolonas_s_metadata", COCO_LABELS, false);
     net.warmupModel();
 
+    // Streaming detector, frames between detections get boxes from tracker
+    YoloNASStream stream(net, detectEvery, motion, score);
+
+    // Overlay is drawn into separate buffer, so captured frame stays untouched
+    OverlayRenderer renderer;
+    cv::Mat display;
+    vector<YoloNAS::detectionInfo> detections;
+
     // Make an capture (currently from file, you can also use and camera source, just insert it's ID)
     cv::VideoCapture cap(modelsPath + "street.mp4");
     
@@ -81,20 +95,22 @@ int main()
         // Run the time counter
         begin = chrono::steady_clock::now();
 
-        // Simply run net.predict(frame) to detect with overlay
-        net.predict(frame, true, score);
+        // Simply run stream.process(frame) to detect (or track), overlay is drawn by renderer
+        stream.process(frame, detections, false);
 
         // Stop the time counter and show the count
         end = chrono::steady_clock::now();
         int inference = chrono::duration_cast<chrono::milliseconds>(end - begin).count();
-        cv::putText(frame, "Inference time: " + to_string(inference) + "ms", cv::Point(20, 40), cv::FONT_HERSHEY_DUPLEX, 0.75, cv::Scalar(255, 255, 0));
+        string mode = stream.lastFrameDetected() ? "detected" : "tracked";
+        renderer.render(frame, detections, display);
+        cv::putText(display, "Inference time: " + to_string(inference) + "ms (" + mode + ")", cv::Point(20, 40), cv::FONT_HERSHEY_DUPLEX, 0.75, cv::Scalar(255, 255, 0));
 
         // Show the result
-        cv::imshow("detection", frame);
+        cv::imshow("detection", display);
 
         // Write video if possible
         if(writeVideo)
-            video.write(frame);
+            video.write(display);
 
         // If pressed ESC, close the program
         char c = (char)cv::waitKey(25);
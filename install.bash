@@ -10,7 +10,7 @@ cd lib
 rm -rf build
 mkdir build
 cd build
-cmake ..
+cmake "$@" ..
 make -j$(nproc)
 make install
 
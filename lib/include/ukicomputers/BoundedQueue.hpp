@@ -0,0 +1,114 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Bounded lock-free multi producer, multi consumer queue (D. Vyukov's ring buffer).
+// Capacity is rounded up to power of two, push and pop never block and return false when full or empty.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t size)
+    {
+        size_t capacity = 2;
+        while (capacity < size)
+            capacity <<= 1;
+
+        buffer.reset(new cell[capacity]);
+        mask = capacity - 1;
+
+        for (size_t i = 0; i < capacity; i++)
+            buffer[i].sequence.store(i, memory_order_relaxed);
+
+        enqueuePos.store(0, memory_order_relaxed);
+        dequeuePos.store(0, memory_order_relaxed);
+    }
+
+    bool push(const T &value)
+    {
+        cell *c;
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+
+        while (true)
+        {
+            c = &buffer[pos & mask];
+            size_t seq = c->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+
+        c->data = value;
+        c->sequence.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        cell *c;
+        size_t pos = dequeuePos.load(memory_order_relaxed);
+
+        while (true)
+        {
+            c = &buffer[pos & mask];
+            size_t seq = c->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+            if (diff == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = dequeuePos.load(memory_order_relaxed);
+            }
+        }
+
+        value = c->data;
+        c->sequence.store(pos + mask + 1, memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+private:
+    struct cell
+    {
+        atomic<size_t> sequence;
+        T data;
+    };
+
+    unique_ptr<cell[]> buffer;
+    size_t mask;
+
+    // Separate cache lines, so producers and consumers do not fight over the same one
+    alignas(64) atomic<size_t> enqueuePos;
+    alignas(64) atomic<size_t> dequeuePos;
+};
@@ -0,0 +1,69 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+
+// LRU cache of NMS results keyed by perceptual hash of the image area of the preprocessed input (padding excluded).
+// Frames whose hashes differ in at most tolerance bits are taken as the same, so re-uploads, thumbnails and static
+// scenes skip the forward pass. Hash sees only coarse brightness gradients, so different frames with the same
+// layout (small object moved or added) can still match and get detections of the other frame.
+// Boxes are stored in input canvas coordinates, so the same content of different resolution is scaled back correctly.
+// Lookups scan all entries (256-bit popcount each), cache is meant for hundreds of entries, not millions.
+class DetectionCache
+{
+public:
+    struct counters
+    {
+        size_t hits, misses, entries;
+    };
+
+    typedef array<uint64_t, 4> hashKey;
+
+    DetectionCache(size_t capacity, int tolerance, double ttlSeconds);
+
+    // 256-bit difference hash of the area of NCHW float blob (first image): channel sum averaged over 17x16 grid,
+    // every bit tells whether a cell is brighter than its left neighbour
+    static hashKey hash(const cv::Mat &blob, cv::Rect area);
+
+    // Fills NMS result of similar cached frame, with keep holding indices 0..n-1, and refreshes its position.
+    // Frames match only with the same canvas and image area in it.
+    bool lookup(const hashKey &key, cv::Size canvas, cv::Rect area, float scoreThresh,
+                vector<cv::Rect> &boxes, vector<int> &labels, vector<float> &scores, vector<int> &keep);
+
+    // Stores NMS survivors (only indices in keep), least recently used entry is evicted when full
+    void store(const hashKey &key, cv::Size canvas, cv::Rect area, float scoreThresh,
+               const vector<cv::Rect> &boxes, const vector<int> &labels, const vector<float> &scores, const vector<int> &keep);
+
+    counters stats() const;
+
+private:
+    struct entry
+    {
+        hashKey key;
+        cv::Size canvas;
+        cv::Rect area;
+        float score;
+        vector<cv::Rect> boxes;
+        vector<int> labels;
+        vector<float> scores;
+        chrono::steady_clock::time_point stored;
+    };
+
+    size_t capacity;
+    int tolerance;
+    chrono::steady_clock::duration ttl; // zero keeps entries until eviction
+
+    // Shared by clones of one detector, so every access is locked
+    mutable mutex lock;
+    list<entry> entries; // most recently used first
+    size_t hits = 0, misses = 0;
+};
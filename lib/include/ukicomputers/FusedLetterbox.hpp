@@ -0,0 +1,66 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <opencv2/opencv.hpp>
+#include "PreprocessPolicy.hpp"
+#include "RawFrame.hpp"
+
+using namespace std;
+
+// Single pass letterbox: reads 8-bit BGR image once and writes planar RGB float NCHW memory,
+// doing bilinear resize, constant padding and per channel normalization on the way
+class FusedLetterbox
+{
+public:
+    // Normalization per source (BGR) channel, output = pixel * mul + add
+    void setNormalization(const float mul[3], const float add[3]);
+    void setPadValue(float value);
+
+    // Geometry of resized image placed inside of canvas (model input), tables are rebuilt only when changed
+    void configure(cv::Size srcSize, cv::Size resized, cv::Size canvas, int padLeft, int padTop);
+
+    // src needs to be CV_8UC3 of configured size, dst needs to hold 3 * canvas.area() floats
+    void run(const cv::Mat &src, float *dst) const;
+
+    // Rows [begin, end) of the canvas, run splits the whole canvas between threads
+    void runRows(const cv::Mat &src, float *dst, int begin, int end) const;
+
+    // Camera buffer of configured size, color conversion is done on the way (source rows are converted once)
+    void run(const rawFrame &src, float *dst) const;
+    void runRawRows(const rawFrame &src, float *dst, int begin, int end) const;
+
+    // Name of instantiation selected for current configuration, e.g. "bilinear/bottom-right/scale/640x640"
+    const char *kernelName() const;
+
+    // Canvas shapes with their own instantiations, YOLO-NAS models are exported with 640x640 input
+    static const int STANDARD_WIDTH = 640, STANDARD_HEIGHT = 640;
+
+private:
+    cv::Size srcSize, resized, canvas;
+    int padLeft = 0, padTop = 0;
+    float mul[3] = {1, 1, 1}, add[3] = {0, 0, 0};
+    float padValue = 0;
+
+    // Precomputed source offsets and bilinear weights for every resized column and row
+    vector<int> xofs, yofs;
+    vector<float> xalpha, yalpha;
+
+    // Kernel specialized by policy, selected whenever geometry or normalization changes
+    typedef void (FusedLetterbox::*rowsKernel)(const cv::Mat &, float *, int, int) const;
+    rowsKernel kernel = nullptr;
+    char kernelLabel[48] = "none";
+
+    static void computeTables(int srcLen, int dstLen, vector<int> &ofs, vector<float> &alpha);
+    void selectKernel();
+
+    template <class Policy>
+    void runPolicy(const cv::Mat &src, float *dst, int begin, int end) const;
+
+    template <resizeMode R, padMode P, normMode N>
+    static rowsKernel shapeKernel(bool standard);
+    template <resizeMode R, padMode P>
+    static rowsKernel normKernel(bool scale, bool standard);
+    template <resizeMode R>
+    static rowsKernel padKernel(padMode pad, bool scale, bool standard);
+};
@@ -0,0 +1,55 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+
+// Engine running the network behind YoloNAS. OpenCV DNN is always available,
+// ONNX Runtime and OpenVINO only when library is built with YOLONAS_WITH_ONNXRUNTIME / YOLONAS_WITH_OPENVINO.
+class InferenceBackend
+{
+public:
+    struct options
+    {
+        int threads = 0;        // intra-op threads, 0 leaves default of the engine
+        int interOpThreads = 0; // inter-op threads (ONNX Runtime) or streams (OpenVINO), 0 leaves default
+        bool cuda = false;      // OpenCV DNN only, falls back to CPU when no CUDA device is found
+    };
+
+    virtual ~InferenceBackend() {}
+
+    // Model is ONNX file in memory (which stays valid while backend exists),
+    // engine errors are thrown as exceptions derived from std::exception
+    virtual void load(const char *model, size_t size) = 0;
+
+    // Blob is NCHW float, it is referenced (not copied) until forward
+    virtual void setInput(cv::Mat &blob) = 0;
+
+    // Outputs are scores [batch, anchors, classes] and boxes [batch, anchors, 4], as one Mat each, in the element
+    // type of the model (CV_32F, CV_16F, CV_8S, CV_8U or CV_32S). Their memory belongs to the backend and may be reused by the next forward.
+    virtual void forward(vector<vector<cv::Mat>> &outputs) = 0;
+
+    // Depths of outputs in forward order, empty when the engine reports them only after the first forward
+    virtual vector<int> outputDepths() const = 0;
+
+    // New unloaded backend of the same engine and options, for another context
+    virtual unique_ptr<InferenceBackend> clone() const = 0;
+
+    virtual const char *name() const = 0;
+
+    // Creates backend by name: "opencv", "onnxruntime" or "openvino", null when it is unknown or not built
+    static unique_ptr<InferenceBackend> create(const string &name, const options &opts);
+
+    // Names of backends built into the library
+    static vector<string> available();
+
+protected:
+    // Engines return outputs in graph order, this puts scores first and boxes (last dimension 4) second
+    static void orderOutputs(vector<vector<cv::Mat>> &outputs);
+
+    // Same order for output depths, from the last dimension of each output shape
+    static void orderDepths(vector<int> &depths, const vector<int64_t> &lastDims);
+};
@@ -0,0 +1,83 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Model file mapped into memory. Besides plain ONNX files it reads bundles written by metadata.py:
+// versioned and checksummed file holding preprocessing settings, label table and ONNX model in one.
+//
+// Bundle layout (version 1, little endian):
+//   bundleHeader (128 bytes)
+//   labels: for every label uint32 length and its bytes
+//   ONNX model, aligned to 64 bytes
+// CRC32 checksum covers everything after the header, header checksum covers the header up to its own field.
+class ModelBundle
+{
+public:
+    struct bundleHeader
+    {
+        char magic[8]; // "YOLONAS\0"
+        uint32_t version;
+        uint32_t headerSize;
+        float iou, score;
+        int32_t width, height;
+        float std;      // 0 when image is not standardized
+        uint32_t flags; // FLAG_* bits
+        float bottomRightPad, centerPad; // 0 when not used
+        float norm[6];  // std[3] and mean[3] when FLAG_NORMALIZE is set
+        uint32_t labelCount;
+        uint32_t checksum;
+        uint64_t labelsOffset, labelsSize;
+        uint64_t modelOffset, modelSize;
+        uint32_t headerChecksum; // CRC32 of bytes 0..111, all fields above
+        uint8_t reserved[12];
+    };
+
+    enum
+    {
+        FLAG_LONGEST_MAX_RESCALE = 1,
+        FLAG_NORMALIZE = 2
+    };
+
+    enum loadResult
+    {
+        LOADED,
+        NOT_FOUND,
+        CORRUPTED,
+        VERSION_UNSUPPORTED
+    };
+
+    static const uint32_t VERSION = 1;
+
+    ModelBundle() {}
+    ~ModelBundle();
+    ModelBundle(const ModelBundle &) = delete;
+    ModelBundle &operator=(const ModelBundle &) = delete;
+
+    // Maps the file, bundle is recognized by its magic, anything else is taken as plain ONNX model
+    loadResult open(const string &path);
+
+    bool isBundle() const;
+    const bundleHeader &header() const;
+    const vector<string> &labels() const;
+
+    // ONNX model inside of the mapping, nothing is copied
+    const char *modelData() const;
+    size_t modelSize() const;
+
+    static uint32_t crc32(const char *data, size_t size);
+
+private:
+    const char *mapping = nullptr;
+    size_t mappingSize = 0;
+    bool bundle = false;
+    bundleHeader head;
+    vector<string> labelTable;
+
+    loadResult parse();
+};
@@ -0,0 +1,60 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "YoloNAS.hpp"
+
+// Draws detections into a separate output buffer instead of the input frame. Label, score and track id texts are
+// rasterized once into cached glyph masks and only composited afterwards, boxes are alpha blended in per-class colors.
+// Rendering can run on own thread, so only frames which are actually displayed get drawn.
+class OverlayRenderer
+{
+public:
+    OverlayRenderer(float boxAlpha = 0.25f, int thickness = 2, double fontScale = 0.5);
+    ~OverlayRenderer();
+    OverlayRenderer(const OverlayRenderer &) = delete;
+    OverlayRenderer &operator=(const OverlayRenderer &) = delete;
+
+    // Copies the frame into output (reused between calls) and draws detections on it, frame is not modified
+    void render(const cv::Mat &frame, const vector<YoloNAS::detectionInfo> &detections, cv::Mat &output);
+
+    // Colors are generated per class, unless set
+    void setClassColor(int classId, cv::Scalar color);
+    cv::Scalar classColor(int classId);
+
+    // Rendering thread: submit copies the frame, latest frames replace older ones which were not drawn yet.
+    // latest returns the newest drawn frame (false when nothing new was drawn since the last call),
+    // so display (cv::imshow) stays on the calling thread. While started, render and setClassColor are not called directly.
+    void start();
+    void submit(const cv::Mat &frame, const vector<YoloNAS::detectionInfo> &detections);
+    bool latest(cv::Mat &output);
+    void stop();
+
+private:
+    float alpha;
+    int thickness;
+    double scale;
+
+    // Glyph masks (text intensity 0 - 255) of the same height: label per class, score 0 - 100 % and characters of track id
+    int glyphHeight, glyphBaseline;
+    vector<cv::Mat> labelGlyphs, scoreGlyphs, trackGlyphs;
+    vector<cv::Scalar> colors;
+    cv::Mat tag, fill; // scratch
+
+    cv::Mat rasterize(const string &text);
+    const cv::Mat &labelGlyph(int classId, const char *label);
+    void drawTag(cv::Mat &output, const YoloNAS::detectionInfo &detection, const cv::Scalar &color);
+
+    // Three buffers rotate between caller, renderer thread and display, so no frame is copied twice
+    thread worker;
+    mutex lock;
+    condition_variable wake;
+    bool running = false, pendingReady = false, drawnReady = false;
+    cv::Mat pending, drawing, drawn;
+    vector<YoloNAS::detectionInfo> pendingDetections, drawingDetections;
+
+    void workerLoop();
+};
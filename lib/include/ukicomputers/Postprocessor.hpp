@@ -0,0 +1,52 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+
+// Decodes raw YOLO-NAS outputs (scores [anchors, classes], boxes [anchors, 4] as x1 y1 x2 y2)
+// into candidates and runs NMS over them, reusing its scratch buffers between calls
+class Postprocessor
+{
+public:
+    // Keep only K best candidates before NMS, 0 keeps all of them
+    void setTopK(int k);
+
+    // Suppress only boxes of the same class, by default all classes suppress each other (as cv::dnn::NMSBoxes)
+    void setClassAware(bool enabled);
+
+    // Outputs are same as before, candidates and indexes of candidates surviving NMS sorted by score
+    void run(const float *scores,
+             const float *bboxes,
+             int anchors,
+             int classes,
+             float scoreThresh,
+             float iouThresh,
+             vector<cv::Rect> &boxesOut,
+             vector<int> &labelsOut,
+             vector<float> &scoresOut,
+             vector<int> &suppressedObjs);
+
+    // Merges detections of overlapping tiles (already in frame coordinates) of the same class.
+    // Overlap is measured as intersection over the smaller box, so parts of an object cut by a tile seam
+    // are merged into the whole one. With weighted, kept boxes are score weighted average of their cluster (WBF).
+    void merge(vector<cv::Rect> &boxes,
+               vector<int> &labels,
+               vector<float> &scores,
+               float overlapThresh,
+               bool weighted,
+               vector<int> &keep);
+
+private:
+    int topK = 0;
+    bool classAware = false;
+
+    // Scratch buffers, cleared but never shrunk
+    vector<int> order;
+    vector<char> suppressed;
+
+    static float rowMax(const float *row, int len);
+    void runNMS(vector<cv::Rect> &boxes, vector<int> &labels, vector<float> &scores, float iouThresh, vector<int> &keep);
+};
@@ -0,0 +1,47 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Timings and counters of predict, all fields are 64-bit so the struct can be published through a seqlock
+struct predictStats
+{
+    // Last predict call
+    uint64_t preprocessNs, forwardNs, postprocessNs, rescaleNs, painterNs, totalNs;
+    uint64_t candidates;     // anchors above score threshold
+    uint64_t detections;     // candidates surviving NMS
+    uint64_t bytesAllocated; // growth of input blob, postprocessing vectors and result vector (outputs of the
+                             // network are owned by the backend and not counted)
+
+    // Totals over all calls
+    uint64_t calls;
+    uint64_t preprocessNsTotal, forwardNsTotal, postprocessNsTotal, rescaleNsTotal, painterNsTotal, totalNsTotal;
+    uint64_t candidatesTotal, detectionsTotal, bytesAllocatedTotal;
+};
+
+// Single writer (the predicting thread), any number of lock-free readers
+class StatsRecorder
+{
+public:
+    StatsRecorder();
+
+    // Stores last call and adds it to totals
+    void record(const predictStats &last);
+
+    // Consistent copy, retried while writer is in the middle of record
+    predictStats snapshot() const;
+
+    // Prometheus text exposition format of a snapshot
+    static string prometheus(const predictStats &st);
+
+private:
+    static const size_t FIELDS = sizeof(predictStats) / sizeof(uint64_t);
+
+    atomic<uint64_t> sequence;
+    atomic<uint64_t> fields[FIELDS];
+};
@@ -0,0 +1,37 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+
+// Compile time description of one preprocessing configuration, FusedLetterbox instantiates its kernel for
+// every combination and selects the matching one at runtime (from geometry and normalization given by metadata)
+enum class resizeMode
+{
+    NONE,    // image already has the resized size, pixels are only converted
+    BILINEAR // bilinear resize (same mapping as cv::resize with INTER_LINEAR)
+};
+
+enum class padMode
+{
+    NONE,         // resized image covers the whole canvas
+    BOTTOM_RIGHT, // image in top left corner, padding right and bottom
+    CENTER        // any placement, padding on every side (generic)
+};
+
+enum class normMode
+{
+    SCALE, // same multiplier for every channel and no offset (standardization only)
+    AFFINE // multiplier and offset per channel (normalization)
+};
+
+// Width and height of 0 are known only at runtime, otherwise canvas has constexpr shape,
+// so loops over its rows have fixed trip count and can be fully unrolled and vectorized
+template <resizeMode R, padMode P, normMode N, int W, int H>
+struct preprocessPolicy
+{
+    static constexpr resizeMode resize = R;
+    static constexpr padMode pad = P;
+    static constexpr normMode norm = N;
+    static constexpr int width = W;
+    static constexpr int height = H;
+};
@@ -0,0 +1,68 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <cstddef>
+
+// Camera buffer described by pointers and strides (in bytes). Library only reads it during the call,
+// it takes no ownership and makes no copy. YUV formats are BT.601 limited range, same as cv::COLOR_YUV2BGR_*.
+struct rawFrame
+{
+    enum format
+    {
+        NV12,      // Y plane, interleaved UV plane of half height
+        I420,      // Y plane, U and V planes of half width and height
+        YUYV,      // packed Y0 U Y1 V
+        RGB_PLANAR // separate R, G and B planes
+    };
+
+    format fmt;
+    int width, height;
+    const unsigned char *planes[3];
+    size_t strides[3];
+
+    static rawFrame nv12(int width, int height, const unsigned char *y, size_t yStride, const unsigned char *uv, size_t uvStride)
+    {
+        return {NV12, width, height, {y, uv, nullptr}, {yStride, uvStride, 0}};
+    }
+
+    static rawFrame i420(int width, int height, const unsigned char *y, size_t yStride,
+                         const unsigned char *u, size_t uStride, const unsigned char *v, size_t vStride)
+    {
+        return {I420, width, height, {y, u, v}, {yStride, uStride, vStride}};
+    }
+
+    static rawFrame yuyv(int width, int height, const unsigned char *data, size_t stride)
+    {
+        return {YUYV, width, height, {data, nullptr, nullptr}, {stride, 0, 0}};
+    }
+
+    static rawFrame rgbPlanar(int width, int height, const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t stride)
+    {
+        return {RGB_PLANAR, width, height, {r, g, b}, {stride, stride, stride}};
+    }
+
+    // Whether the frame can be read: positive size, even size where chroma is subsampled
+    // (width for NV12, I420 and YUYV, also height for 4:2:0), every used plane set and wide enough for its row
+    bool valid() const
+    {
+        if (width <= 0 || height <= 0)
+            return false;
+
+        size_t w = width;
+        switch (fmt)
+        {
+        case NV12:
+            return width % 2 == 0 && height % 2 == 0 && planes[0] && planes[1] && strides[0] >= w && strides[1] >= w;
+        case I420:
+            return width % 2 == 0 && height % 2 == 0 && planes[0] && planes[1] && planes[2] &&
+                   strides[0] >= w && strides[1] >= w / 2 && strides[2] >= w / 2;
+        case YUYV:
+            return width % 2 == 0 && planes[0] && strides[0] >= w * 2;
+        case RGB_PLANAR:
+            return planes[0] && planes[1] && planes[2] && strides[0] >= w && strides[1] >= w && strides[2] >= w;
+        }
+
+        return false;
+    }
+};
@@ -0,0 +1,111 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "YoloNAS.hpp"
+
+// Multiplexes many camera feeds onto one detector. Every stream is read by own capture thread, which keeps only the
+// latest frame. Scheduler thread forms batches of the latest frames: streams are served by weighted fair share
+// (least served per weight first) and at most at their target FPS, and batch size is chosen so the oldest frame
+// of the batch still meets the latency SLO (capture to result), using measured latency of every batch size.
+// Results are routed to per-stream callbacks, called on the scheduler thread.
+class StreamScheduler
+{
+public:
+    // Fills next frame, returns false at the end of the stream. Called on the capture thread of the stream.
+    // Must return within a bounded time (use read timeouts of network cameras), as removeStream and the
+    // destructor wait for the call in progress.
+    typedef function<bool(cv::Mat &frame)> frameSource;
+    typedef function<void(int streamId, cv::Mat &frame, vector<YoloNAS::detectionInfo> &detections)> resultCallback;
+
+    struct streamStats
+    {
+        size_t captured;  // frames read from the source
+        size_t processed; // frames detected
+        size_t dropped;   // frames replaced by newer ones before the scheduler took them
+        size_t sloMisses; // processed frames with latency above the SLO
+        size_t errors;    // frames whose predict threw, not delivered
+        double meanLatency; // seconds from capture to result
+        bool finished;      // source reached the end of the stream
+    };
+
+    StreamScheduler(YoloNAS &detector, double latencySlo = 0.1, int maxBatch = 8, float scoreThresh = -1.00);
+    ~StreamScheduler();
+    StreamScheduler(const StreamScheduler &) = delete;
+    StreamScheduler &operator=(const StreamScheduler &) = delete;
+
+    // targetFps of 0 serves the stream as often as its fair share allows, weight scales the share
+    int addStream(frameSource source, resultCallback callback, double targetFps = 0, int weight = 1);
+    // Blocks until the running callback and the current source call of the stream return, no results of the
+    // stream are delivered afterwards. Can be called from a callback, without waiting for that callback.
+    void removeStream(int id);
+
+    void start();
+    void stop();
+
+    streamStats stats(int id) const;
+
+    // Video file or URL (cv::VideoCapture), files are paced to their FPS so they behave like live cameras
+    static frameSource videoSource(const string &path, bool paceToFps = true);
+
+    // Stand-in camera for testing: moving rectangle on gray background at given FPS
+    static frameSource syntheticSource(cv::Size size, double fps);
+
+private:
+    struct stream
+    {
+        int id;
+        frameSource source;
+        resultCallback callback;
+        double period; // 0 without target FPS
+        int weight;
+
+        thread capture;
+        bool stopped = false;
+
+        // Latest captured frame, swapped with buffers of capture and scheduler thread
+        cv::Mat latest, processing;
+        bool fresh = false;
+        chrono::steady_clock::time_point capturedAt, processingCapturedAt, nextDue;
+        double virtualTime = 0; // served frames divided by weight
+
+        streamStats st = streamStats();
+        double latencySum = 0;
+    };
+
+    YoloNAS &net;
+    double slo;
+    int maxBatch;
+    float score;
+    bool batchSupported = true;
+
+    mutable mutex lock;
+    condition_variable wake;
+    map<int, shared_ptr<stream>> streams;
+    int nextId = 0;
+    bool running = false;
+    thread scheduler;
+
+    // Stream whose callback runs on the scheduler thread (-1 for none), removeStream waits for it
+    int callingBack = -1;
+    condition_variable callbackDone;
+
+    // Measured latency of forward of every batch size (exponential moving average, seconds)
+    vector<double> batchLatency;
+
+    // Reused per round
+    vector<shared_ptr<stream>> candidates, batch;
+    vector<cv::Mat> frames;
+    vector<vector<YoloNAS::detectionInfo>> results;
+    vector<char> failed;
+
+    void captureLoop(stream *s);
+    void schedulerLoop();
+    bool selectBatch(chrono::steady_clock::time_point &wakeAt);
+    double estimate(size_t size) const;
+};
@@ -3,8 +3,16 @@
 
 #pragma once
 #include <fstream>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <opencv2/dnn.hpp>
+#include "FusedLetterbox.hpp"
+#include "Postprocessor.hpp"
+#include "PredictStats.hpp"
+#include "InferenceBackend.hpp"
+#include "ModelBundle.hpp"
+#include "DetectionCache.hpp"
+#include <functional>
 
 using namespace std;
 
@@ -15,13 +23,97 @@ public:
     {
         int x, y, w, h;
         float score;
-        string label;
+        int classId;
+        const char *label; // points into labels of YoloNAS, valid while it exists
+        int trackId;       // stable id assigned by YoloNASStream, -1 for single image detection
+    };
+
+    // How detections of overlapping tiles are merged
+    enum tileMerge
+    {
+        TILE_MERGE_NMS, // keep the best scored box of a cluster
+        TILE_MERGE_WBF  // score weighted average of all boxes of a cluster
     };
 
     YoloNAS(string netPath, string config, vector<string> lbls, bool cuda = false);
+
+    // Runs the network on given backend ("opencv", "onnxruntime" or "openvino"), see InferenceBackend
+    YoloNAS(string netPath, string config, vector<string> lbls, string backendName, InferenceBackend::options backendOptions = InferenceBackend::options());
+
+    // Loads bundle written by metadata.py, which holds model, preprocessing settings and labels in one memory mapped file
+    explicit YoloNAS(string bundlePath, string backendName = "opencv", InferenceBackend::options backendOptions = InferenceBackend::options());
     vector<detectionInfo> predict(cv::Mat &img, bool applyOverlayOnImage = true, float scoreThresh = -1.00);
+    void predict(cv::Mat &img, vector<detectionInfo> &out, bool applyOverlayOnImage = true, float scoreThresh = -1.00);
+    vector<vector<detectionInfo>> predictBatch(vector<cv::Mat> &imgs, bool applyOverlayOnImage = true, float scoreThresh = -1.00);
+
+    // Camera buffers (NV12, I420, YUYV, planar RGB) are letterboxed directly, without intermediate BGR image.
+    // There is no image to draw on, so no overlay is applied.
+    vector<detectionInfo> predict(const rawFrame &frame, float scoreThresh = -1.00);
+    void predict(const rawFrame &frame, vector<detectionInfo> &out, float scoreThresh = -1.00);
+    void setMaxBatchSize(int size);
+
+    // Sliced inference for frames much larger than model input: overlapping tiles of model size are cut as ROIs,
+    // batched through forward (up to max batch size), mapped back to the frame and merged across tile seams
+    vector<detectionInfo> predictTiled(cv::Mat &img, bool applyOverlayOnImage = true, float scoreThresh = -1.00);
+    void predictTiled(cv::Mat &img, vector<detectionInfo> &out, bool applyOverlayOnImage = true, float scoreThresh = -1.00);
+    void setTiling(float overlap, bool fullFrame = true, tileMerge merge = TILE_MERGE_NMS);
+
+    // Region of interest inference for fixed cameras: only crops around the monitored regions (frame coordinates)
+    // are letterboxed and run, detections are kept when their center lies inside of the region mask.
+    // Regions are merged into one crop of their union, or with separateCrops each one is run as own crop (batched).
+    void setRegions(const vector<vector<cv::Point>> &polygons, bool separateCrops = false);
+    void setRegionMask(const cv::Mat &mask, bool separateCrops = false);
+    void clearRegions();
+    vector<detectionInfo> predictRegions(cv::Mat &img, bool applyOverlayOnImage = true, float scoreThresh = -1.00);
+    void predictRegions(cv::Mat &img, vector<detectionInfo> &out, bool applyOverlayOnImage = true, float scoreThresh = -1.00);
+
+    // For models exported with dynamic height and width: every frame is fitted into the metadata size and
+    // rounded up to the stride (1920x1080 gives 640x384 instead of 640x640 input). Batches and tiles keep the metadata size.
+    void setDynamicInput(bool enabled, int stride = 32);
+
+    // Optional cache in front of forward pass for duplicate and near-duplicate frames (see DetectionCache), used by predict.
+    // tolerance is number of differing bits of 256-bit hash, ttl of 0 keeps entries until evicted, capacity of 0 disables it.
+    // Hash is perceptual, so even with tolerance 0 a frame that differs only in a small detail (object moved by a few
+    // pixels, small object added) can hit and get detections of the cached frame; use it where that is acceptable.
+    // Cache is shared with clones created afterwards.
+    void setCache(size_t capacity, int tolerance = 0, double ttlSeconds = 0);
+    DetectionCache::counters cacheStats() const;
+
+    void setTopK(int k);
+    void setClassAwareNMS(bool enabled);
     void warmupModel();
 
+    // INT8 / FP16 models: outputs of other type than float are converted before postprocessing.
+    // Whether some output (as reported by the backend) is not float, runs warmup when backend knows types only after forward.
+    bool isQuantized();
+    // Integer outputs (model exported without final DequantizeLinear) use value = (q - zeroPoint) * scale, with one
+    // scale and zero point per output in order scores, boxes. Predict throws OUTPUT_QUANTIZATION_NOT_SET without them.
+    void setOutputQuantization(const vector<float> &scales, const vector<int> &zeroPoints);
+
+    // Stage timings and counters of predict, recorded only when library is built with YOLONAS_ENABLE_STATS.
+    // Only single image predict (cv::Mat and rawFrame) is recorded, so pool contexts are recorded too;
+    // predictBatch, predictTiled, predictRegions with regions set and stages called directly (as by YoloNASPipeline) are not.
+    predictStats stats() const;
+    string statsPrometheus() const;
+    void setStatsCallback(function<void(const predictStats &)> callback);
+
+    // Creates independent context for another thread, without reading model and metadata files again
+    unique_ptr<YoloNAS> clone() const;
+
+    // Separate stages of predict, so they can run on different threads (one thread per stage, different frames)
+    void preprocess(cv::Mat &img, cv::Mat &blob);
+    void preprocess(vector<cv::Mat> &imgs, cv::Mat &blob);
+    void preprocess(const rawFrame &frame, cv::Mat &blob);
+    void infer(cv::Mat &blob, vector<vector<cv::Mat>> &outDet);
+    vector<detectionInfo> postprocess(vector<vector<cv::Mat>> &outDet, cv::Mat &img, bool applyOverlayOnImage = true, float scoreThresh = -1.00);
+
+    // Parts of postprocess: score filtering & NMS, scaling back to image size and drawing overlay.
+    // rescale maps the image of the batch index last given to decode, with the canvas it was preprocessed into.
+    void decode(vector<vector<cv::Mat>> &outDet, float scoreThresh = -1.00, int batchIdx = 0);
+    vector<detectionInfo> rescale(cv::Size imgSize);
+    void rescale(cv::Size imgSize, vector<detectionInfo> &out);
+    void draw(cv::Mat &img, vector<detectionInfo> &detections);
+
 private:
     struct metadataConfig
     {
@@ -30,17 +122,84 @@ private:
         float std;
         bool dlmr;
         int brm, cp;
-        vector<int> norm;
+        vector<float> norm;
     };
 
-    cv::dnn::Net net;
+    // Backend is not copyable, so clone creates its own
+    shared_ptr<InferenceBackend> backend;
     cv::Size outShape;
+    shared_ptr<ModelBundle> model; // mapping is shared by clones
 
     metadataConfig cfg;
     vector<string> labels;
+    int maxBatchSize = 8;
+    bool dynamicInput = false;
+    int dynamicStride = 32;
+
+    // Preprocessing kernel and reused NCHW input blob
+    FusedLetterbox letterbox;
+    cv::Mat inputBlob;
+    vector<vector<cv::Mat>> outDet;
+
+    // Canvas of every image of the last batch preprocess (model size), used by rescale for the decoded batch index.
+    // Single image preprocess clears it, only when it is not already empty, so stages of YoloNASPipeline (which
+    // run single image stages of one context on different threads) never write it.
+    vector<cv::Size> batchCanvases;
+    int decodedIdx = 0;
+
+    // Float copies of quantized or half precision outputs
+    vector<cv::Mat> dequantized;
+    vector<float> outScales;
+    vector<int> outZeroPoints;
 
+    // Postprocessing and its reused result vectors
+    Postprocessor postprocessor;
+    vector<float> scores;
+    vector<cv::Rect> boxes;
+    vector<int> detectionLabels, suppressedObjs;
+
+    // Tiled inference settings and its reused buffers
+    float tileOverlap = 0.2f;
+    bool tileFullFrame = true;
+    tileMerge tileMergeMode = TILE_MERGE_NMS;
+    bool batchSupported = true;
+    vector<cv::Rect> tiles, tileBoxes;
+    vector<int> tileLabels, tileKeep;
+    vector<float> tileScores;
+    vector<detectionInfo> tileDetections;
+
+    // Monitored regions, mask is rasterized from polygons once per frame size, crops are cached with it
+    // (for the frame size regionsSize, valid while regionsComputed is set)
+    vector<vector<cv::Point>> regionPolygons;
+    cv::Mat regionMask;
+    bool regionSeparate = false;
+    vector<cv::Rect> regionCrops;
+    cv::Size regionsSize;
+    bool regionsComputed = false;
+
+    shared_ptr<DetectionCache> cache;
+
+    // Instrumentation (recorder is not copyable, so clone creates its own)
+    shared_ptr<StatsRecorder> statsRecorder;
+    function<void(const predictStats &)> statsCallback;
+    size_t scratchBytes(const vector<detectionInfo> &out) const;
+
+    void init(const string &netPath, const string &backendName, const InferenceBackend::options &backendOptions);
+    void readBundleConfig();
+    void loadNet();
     void readConfig(string filePath);
-    cv::Mat runPreProcessing(cv::Mat &img);
+    void setupPreProcessing();
+    cv::Size inputCanvas(cv::Size imgSize);
+    void letterboxGeometry(cv::Size imgSize, cv::Size canvas, cv::Size &resized, int &padLeft, int &padTop);
+    cv::Mat prepareImage(cv::Mat &img, cv::Size canvas);
+    void preprocessInto(cv::Mat &img, cv::Size canvas, float *dst);
+    void runPreProcessing(vector<cv::Mat> &imgs, size_t first, size_t count, cv::Mat &blob);
+    bool cachedDecode(cv::Size imgSize, float scoreThresh, DetectionCache::hashKey &key, cv::Rect &area);
+    void storeDecoded(float scoreThresh, const DetectionCache::hashKey &key, cv::Rect area);
+    void computeTiles(cv::Size imgSize);
+    void runTilePreProcessing(cv::Mat &img, size_t first, size_t count, cv::Mat &blob);
+    void runTiles(cv::Mat &img, vector<detectionInfo> &out, float scoreThresh);
+    void updateRegions(cv::Size imgSize);
     void exceptionHandler(int ex);
     void painter(cv::Mat &img, detectionInfo &detection);
 
@@ -50,5 +209,15 @@ private:
                             vector<int> &labelsOut,
                             vector<float> &scoresOut,
                             vector<int> &suppressedObjs,
-                            float &scoreThresh);
+                            float &scoreThresh,
+                            int batchIdx = 0);
+
+    // Maps NMS survivors from the canvas back to the image (inverse of the letterbox)
+    void collectDetections(cv::Size imgSize,
+                           cv::Size canvas,
+                           vector<cv::Rect> &boxes,
+                           vector<int> &detectionLabels,
+                           vector<float> &scores,
+                           vector<int> &suppressedObjs,
+                           vector<detectionInfo> &result);
 };
\ No newline at end of file
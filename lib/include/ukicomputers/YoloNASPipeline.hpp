@@ -0,0 +1,74 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <thread>
+#include <future>
+#include <mutex>
+#include <functional>
+#include "YoloNAS.hpp"
+#include "BoundedQueue.hpp"
+
+// Runs preprocess, inference and postprocess of YoloNAS as three stages on their own threads,
+// connected with bounded lock-free queues. Results are delivered in the same order as frames were submitted.
+class YoloNASPipeline
+{
+public:
+    // What submit does when input queue is full
+    enum overflowPolicy
+    {
+        BLOCK,      // wait until there is space (backpressure to the caller)
+        DROP_OLDEST // drop the oldest waiting frame, useful for live camera feeds
+    };
+
+    // Error is null on success, otherwise detections are empty and error holds FRAME_DROPPED, PIPELINE_STOPPED,
+    // QUEUE_FULL or exception of the failed stage
+    typedef function<void(cv::Mat &img, vector<YoloNAS::detectionInfo> &detections, exception_ptr error)> resultCallback;
+
+    YoloNASPipeline(YoloNAS &detector, size_t queueSize = 4, overflowPolicy policy = BLOCK, bool applyOverlayOnImage = false, float scoreThresh = -1.00);
+    ~YoloNASPipeline();
+
+    // Frame is referenced (not copied) until its result is delivered, overlay is drawn onto it if enabled.
+    // Future of dropped frame throws FRAME_DROPPED, callback gets it as error.
+    // Callbacks run on the postprocess thread, which drains the queues, so submit called from a callback never
+    // waits with BLOCK policy: frame which does not fit fails right away with QUEUE_FULL (not to be resubmitted).
+    future<vector<YoloNAS::detectionInfo>> submit(cv::Mat img);
+    void submit(cv::Mat img, resultCallback callback);
+
+    // Processes all submitted frames and stops the stages, called by destructor.
+    // Call it after the producer stopped submitting, later submits fail with PIPELINE_STOPPED.
+    void stop();
+
+    size_t droppedFrames() const;
+
+private:
+    struct job
+    {
+        cv::Mat img, blob;
+        vector<vector<cv::Mat>> outDet;
+        promise<vector<YoloNAS::detectionInfo>> result;
+        resultCallback callback;
+        exception_ptr error;
+    };
+
+    YoloNAS &net;
+    overflowPolicy policy;
+    bool overlay;
+    float score;
+
+    BoundedQueue<job *> inputQueue, inferQueue, postQueue;
+    mutex submitLock; // check of accepting and push into input queue happen together, so stop can not miss a job
+    atomic<bool> accepting, inputDone, preprocessDone, inferDone;
+    atomic<size_t> dropped;
+    thread preprocessThread, inferThread, postprocessThread;
+
+    void enqueue(job *j);
+    void fail(job *j, exception_ptr error);
+    void complete(job *j, vector<YoloNAS::detectionInfo> &detections, exception_ptr error);
+    void preprocessStage();
+    void inferStage();
+    void postprocessStage();
+
+    static void waitPush(BoundedQueue<job *> &queue, job *j);
+    static bool waitPop(BoundedQueue<job *> &queue, job *&j, atomic<bool> &upstreamDone);
+};
@@ -0,0 +1,184 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <atomic>
+#include <functional>
+#include "YoloNAS.hpp"
+
+// Pool of independent YoloNAS contexts created from one read of model and metadata.
+// Contexts are used either directly through a lease, or by worker threads executing submitted frames.
+class YoloNASPool
+{
+public:
+    struct contextStats
+    {
+        size_t jobs;        // frames predicted by the context (submitted and leased)
+        double busySeconds; // time the context was in use
+        double utilization; // busySeconds / pool lifetime, from 0.0 to 1.0
+    };
+
+    // Lane of async request, queued interactive frames are always taken before normal ones
+    enum priority
+    {
+        PRIORITY_NORMAL,
+        PRIORITY_INTERACTIVE
+    };
+
+    enum asyncStatus
+    {
+        ASYNC_DONE,
+        ASYNC_CANCELLED,         // cancelled while queued
+        ASYNC_DEADLINE_EXCEEDED, // deadline passed before some worker took the frame
+        ASYNC_QUEUE_FULL,        // rejected, queue limit was reached
+        ASYNC_FAILED             // predict threw, exception is in the future
+    };
+
+    // Called on the worker thread for every request, with empty detections when frame was not predicted
+    typedef function<void(asyncStatus status, cv::Mat &img, vector<YoloNAS::detectionInfo> &detections)> completionCallback;
+
+    struct asyncOptions
+    {
+        priority lane = PRIORITY_NORMAL;
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max(); // no deadline by default
+        bool applyOverlayOnImage = false;
+        float scoreThresh = -1.00;
+        completionCallback callback;
+    };
+
+    // Handle of async request. Future of a frame which was not predicted throws REQUEST_CANCELLED,
+    // DEADLINE_EXCEEDED or QUEUE_FULL.
+    class asyncRequest
+    {
+    public:
+        future<vector<YoloNAS::detectionInfo>> result;
+
+        // Queued frame is dropped, frame which is already being predicted finishes normally
+        void cancel();
+
+        // Registers function run by the worker right after the result is set (used by co_await),
+        // returns false without registering when the result is already set (or the handle is empty)
+        bool then(function<void()> continuation);
+
+    private:
+        friend class YoloNASPool;
+        struct state;
+        shared_ptr<state> shared;
+    };
+
+    // Exclusive access to one context, returned to the pool when lease is destroyed
+    class lease
+    {
+    public:
+        lease(lease &&other);
+        ~lease();
+
+        YoloNAS &operator*();
+        YoloNAS *operator->();
+
+    private:
+        friend class YoloNASPool;
+        lease(YoloNASPool *owner, size_t idx);
+
+        YoloNASPool *pool;
+        size_t index;
+        chrono::steady_clock::time_point begin;
+    };
+
+    YoloNASPool(string netPath, string config, vector<string> lbls, size_t contexts = thread::hardware_concurrency(), bool cuda = false);
+    ~YoloNASPool();
+
+    // Blocks until some context is free
+    lease acquire();
+
+    // Frame is predicted by the first free worker, idle workers steal queued frames of busy ones
+    future<vector<YoloNAS::detectionInfo>> submit(cv::Mat img, bool applyOverlayOnImage = false, float scoreThresh = -1.00);
+
+    // Non blocking predict for event loops: frame is queued in its priority lane and request can be cancelled,
+    // frames which are still queued at their deadline are dropped instead of being predicted late
+    asyncRequest predictAsync(cv::Mat img);
+    asyncRequest predictAsync(cv::Mat img, const asyncOptions &options);
+
+    // Maximal number of queued frames, further requests are rejected with QUEUE_FULL (0 means unlimited)
+    void setQueueLimit(size_t limit);
+
+    size_t size() const;
+    vector<contextStats> stats() const;
+
+private:
+    struct task
+    {
+        cv::Mat img;
+        asyncOptions opts;
+        promise<vector<YoloNAS::detectionInfo>> result;
+        shared_ptr<asyncRequest::state> shared;
+    };
+
+    struct context
+    {
+        unique_ptr<YoloNAS> net;
+        mutex use; // held by worker while predicting, or by a lease
+
+        mutex queueLock;
+        deque<task *> tasks[2]; // one per priority lane
+
+        atomic<size_t> jobs;
+        atomic<long long> busyNs;
+        thread worker;
+    };
+
+    vector<unique_ptr<context>> contexts;
+    chrono::steady_clock::time_point created;
+
+    // Sleeping of idle workers and waiting for free context in acquire
+    mutex sleepLock;
+    condition_variable wake, released;
+    size_t pending;
+    size_t queueLimit;
+    bool running;
+    atomic<size_t> nextQueue;
+
+    void workerLoop(size_t idx);
+    bool takeTask(size_t idx, task *&t);
+    void finish(task *t, asyncStatus status, vector<YoloNAS::detectionInfo> &detections, exception_ptr error = nullptr);
+    void release(size_t idx, chrono::steady_clock::time_point begin);
+};
+
+// C++20 callers can co_await a request (co_await pool.predictAsync(img)), coroutine is then resumed
+// on the worker thread which finished the frame. Library itself is built as C++11.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+
+struct yoloNASAwaiter
+{
+    YoloNASPool::asyncRequest request;
+
+    bool await_ready()
+    {
+        return request.result.wait_for(chrono::seconds(0)) == future_status::ready;
+    }
+
+    bool await_suspend(coroutine_handle<> handle)
+    {
+        return request.then([handle]()
+                            { handle.resume(); });
+    }
+
+    vector<YoloNAS::detectionInfo> await_resume()
+    {
+        return request.result.get();
+    }
+};
+
+inline yoloNASAwaiter operator co_await(YoloNASPool::asyncRequest &&request)
+{
+    return yoloNASAwaiter{move(request)};
+}
+#endif
+#endif
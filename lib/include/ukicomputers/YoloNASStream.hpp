@@ -0,0 +1,74 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#pragma once
+#include "YoloNAS.hpp"
+
+// Streaming detector for video: full YoloNAS inference runs only on every Nth frame (or earlier when the scene moves),
+// frames in between get boxes propagated by SORT-style tracks (constant velocity Kalman filter, IoU matching).
+// Every returned detection has stable trackId. Regions set on the detector (setRegions) are respected.
+class YoloNASStream
+{
+public:
+    // motionThresh is mean absolute difference (0 - 1) of a small grayscale copy against the last detected frame,
+    // negative value disables motion check, so detection runs strictly every detectEvery frames
+    YoloNASStream(YoloNAS &detector, int detectEvery = 3, float motionThresh = -1.00, float scoreThresh = -1.00);
+
+    vector<YoloNAS::detectionInfo> process(cv::Mat &frame, bool applyOverlayOnImage = true);
+    void process(cv::Mat &frame, vector<YoloNAS::detectionInfo> &out, bool applyOverlayOnImage = true);
+
+    // Minimal IoU of detection and predicted track box to match them, and number of detection rounds
+    // which track survives without a match (it is not returned meanwhile, but keeps its id if found again)
+    void setTracking(float iouThresh, int maxMisses = 2);
+
+    // Whether the last processed frame went through full inference
+    bool lastFrameDetected() const;
+
+    // Forgets all tracks, call it when the source changes
+    void reset();
+
+private:
+    struct track
+    {
+        int id, classId;
+        const char *label;
+        float score;
+        int misses;
+        cv::Rect box; // of the current frame
+        cv::KalmanFilter kf;
+    };
+
+    struct match
+    {
+        float iou;
+        int trackIdx, detectionIdx;
+    };
+
+    YoloNAS &net;
+    int every;
+    float motion, score;
+    float iou = 0.3f;
+    int maxMisses = 2;
+
+    int sinceDetection;
+    bool detected = false;
+    int nextId = 0;
+
+    // Tracks and reused matching buffers
+    vector<track> tracks;
+    vector<YoloNAS::detectionInfo> detections;
+    vector<match> matches;
+    vector<char> trackMatched, detectionMatched;
+    cv::Mat_<float> measurement;
+
+    // Small grayscale copies of the current and the last detected frame
+    cv::Mat small, smallGray, lastGray;
+
+    float sceneMotion(cv::Mat &frame);
+    void initTrack(track &t, const YoloNAS::detectionInfo &detection);
+    void predictTracks(cv::Size frameSize);
+    void updateTracks();
+
+    static cv::Rect stateBox(const cv::Mat &state, cv::Size frameSize);
+    static float overlap(const cv::Rect &a, const cv::Rect &b);
+};
@@ -0,0 +1,141 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/DetectionCache.hpp"
+
+DetectionCache::DetectionCache(size_t capacity, int tolerance, double ttlSeconds)
+    : capacity(max(capacity, (size_t)1)), tolerance(max(tolerance, 0)),
+      ttl(chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(max(ttlSeconds, 0.0))))
+{
+}
+
+DetectionCache::hashKey DetectionCache::hash(const cv::Mat &blob, cv::Rect area)
+{
+    const int width = blob.size[3];
+    const size_t plane = (size_t)blob.size[2] * width;
+    const float *data = blob.ptr<float>(0);
+
+    // Every 4th pixel of every 4th row is enough for cell means, hash has to stay far cheaper than forward
+    const int step = 4;
+    float cells[16][17];
+    for (int gy = 0; gy < 16; gy++)
+    {
+        int y0 = area.y + gy * area.height / 16, y1 = max(area.y + (gy + 1) * area.height / 16, y0 + 1);
+        for (int gx = 0; gx < 17; gx++)
+        {
+            int x0 = area.x + gx * area.width / 17, x1 = max(area.x + (gx + 1) * area.width / 17, x0 + 1);
+
+            float sum = 0;
+            int count = 0;
+            for (int y = y0; y < y1; y += step)
+            {
+                const float *row = data + (size_t)y * width;
+                for (int x = x0; x < x1; x += step)
+                {
+                    sum += row[x] + row[plane + x] + row[2 * plane + x];
+                    count++;
+                }
+            }
+            cells[gy][gx] = sum / count;
+        }
+    }
+
+    // Four rows of the grid per word
+    hashKey key = {{0, 0, 0, 0}};
+    for (int gy = 0; gy < 16; gy++)
+        for (int gx = 0; gx < 16; gx++)
+            key[gy / 4] = (key[gy / 4] << 1) | (cells[gy][gx + 1] > cells[gy][gx] ? 1 : 0);
+    return key;
+}
+
+// Number of differing bits
+static int distance(const DetectionCache::hashKey &a, const DetectionCache::hashKey &b)
+{
+    int count = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        uint64_t v = a[i] ^ b[i];
+        while (v)
+        {
+            v &= v - 1;
+            count++;
+        }
+    }
+    return count;
+}
+
+bool DetectionCache::lookup(const hashKey &key, cv::Size canvas, cv::Rect area, float scoreThresh,
+                            vector<cv::Rect> &boxes, vector<int> &labels, vector<float> &scores, vector<int> &keep)
+{
+    lock_guard<mutex> guard(lock);
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        // Expired entries are dropped on the way
+        if (ttl.count() > 0 && now - it->stored > ttl)
+        {
+            it = entries.erase(it);
+            continue;
+        }
+
+        if (it->canvas != canvas || it->area != area || it->score != scoreThresh || distance(it->key, key) > tolerance)
+        {
+            ++it;
+            continue;
+        }
+
+        boxes.assign(it->boxes.begin(), it->boxes.end());
+        labels.assign(it->labels.begin(), it->labels.end());
+        scores.assign(it->scores.begin(), it->scores.end());
+        keep.resize(boxes.size());
+        for (size_t i = 0; i < keep.size(); i++)
+            keep[i] = i;
+
+        entries.splice(entries.begin(), entries, it);
+        hits++;
+        return true;
+    }
+
+    misses++;
+    return false;
+}
+
+void DetectionCache::store(const hashKey &key, cv::Size canvas, cv::Rect area, float scoreThresh,
+                           const vector<cv::Rect> &boxes, const vector<int> &labels, const vector<float> &scores, const vector<int> &keep)
+{
+    lock_guard<mutex> guard(lock);
+
+    // Evicted entry is reused, so its vectors keep their capacity
+    if (entries.size() >= capacity)
+        entries.splice(entries.begin(), entries, prev(entries.end()));
+    else
+        entries.push_front(entry());
+
+    entry &e = entries.front();
+    e.key = key;
+    e.canvas = canvas;
+    e.area = area;
+    e.score = scoreThresh;
+    e.stored = chrono::steady_clock::now();
+    e.boxes.clear();
+    e.labels.clear();
+    e.scores.clear();
+    for (auto i : keep)
+    {
+        e.boxes.push_back(boxes[i]);
+        e.labels.push_back(labels[i]);
+        e.scores.push_back(scores[i]);
+    }
+}
+
+DetectionCache::counters DetectionCache::stats() const
+{
+    lock_guard<mutex> guard(lock);
+
+    counters c;
+    c.hits = hits;
+    c.misses = misses;
+    c.entries = entries.size();
+    return c;
+}
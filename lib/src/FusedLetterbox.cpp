@@ -0,0 +1,496 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/FusedLetterbox.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+
+void FusedLetterbox::setNormalization(const float m[3], const float a[3])
+{
+    for (int c = 0; c < 3; c++)
+    {
+        mul[c] = m[c];
+        add[c] = a[c];
+    }
+
+    selectKernel();
+}
+
+void FusedLetterbox::setPadValue(float value)
+{
+    padValue = value;
+}
+
+void FusedLetterbox::computeTables(int srcLen, int dstLen, vector<int> &ofs, vector<float> &alpha)
+{
+    ofs.resize(dstLen);
+    alpha.resize(dstLen);
+
+    // Same pixel center mapping as cv::resize with INTER_LINEAR
+    float scale = (float)srcLen / (float)dstLen;
+    for (int i = 0; i < dstLen; i++)
+    {
+        float s = (i + 0.5f) * scale - 0.5f;
+        int s0 = cvFloor(s);
+        float a = s - s0;
+
+        if (s0 < 0)
+        {
+            s0 = 0;
+            a = 0;
+        }
+        if (s0 >= srcLen - 1)
+        {
+            s0 = srcLen - 1;
+            a = 0;
+        }
+
+        ofs[i] = s0;
+        alpha[i] = a;
+    }
+}
+
+void FusedLetterbox::configure(cv::Size src, cv::Size rsz, cv::Size cnv, int left, int top)
+{
+    if (src == srcSize && rsz == resized && cnv == canvas && left == padLeft && top == padTop)
+        return;
+
+    srcSize = src;
+    resized = rsz;
+    canvas = cnv;
+    padLeft = left;
+    padTop = top;
+
+    computeTables(srcSize.width, resized.width, xofs, xalpha);
+    computeTables(srcSize.height, resized.height, yofs, yalpha);
+
+    // Column offsets are stored as element offsets in the interleaved row
+    for (auto &x : xofs)
+        x *= 3;
+
+    selectKernel();
+}
+
+// Vertical bilinear blend of two interleaved 8-bit rows into a float row
+static void blendRows(const uchar *r0, const uchar *r1, float a, float *out, int len)
+{
+    int i = 0;
+#if CV_SIMD
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    cv::v_float32 va = cv::vx_setall_f32(a);
+    for (; i <= len - lanes; i += lanes)
+    {
+        cv::v_float32 v0 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(cv::vx_load_expand_q(r0 + i)));
+        cv::v_float32 v1 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(cv::vx_load_expand_q(r1 + i)));
+        cv::v_store(out + i, cv::v_fma(cv::v_sub(v1, v0), va, v0));
+    }
+    cv::vx_cleanup();
+#endif
+    for (; i < len; i++)
+        out[i] = r0[i] + a * (r1[i] - r0[i]);
+}
+
+// Rows of the canvas are split between threads, body is a class as std::function of a lambda would allocate
+class letterboxBody : public cv::ParallelLoopBody
+{
+public:
+    letterboxBody(const FusedLetterbox &k, const cv::Mat &s, float *d) : kernel(k), src(s), dst(d) {}
+
+    void operator()(const cv::Range &range) const override
+    {
+        kernel.runRows(src, dst, range.start, range.end);
+    }
+
+private:
+    const FusedLetterbox &kernel;
+    const cv::Mat &src;
+    float *dst;
+};
+
+void FusedLetterbox::run(const cv::Mat &src, float *dst) const
+{
+    cv::parallel_for_(cv::Range(0, canvas.height), letterboxBody(*this, src, dst));
+}
+
+void FusedLetterbox::runRows(const cv::Mat &src, float *dst, int begin, int end) const
+{
+    (this->*kernel)(src, dst, begin, end);
+}
+
+const char *FusedLetterbox::kernelName() const
+{
+    return kernelLabel;
+}
+
+// Converts one interleaved 8-bit row of final size into three normalized float planes
+template <normMode N>
+static void convertRow(const uchar *src, float *outB, float *outG, float *outR, int width, const float mul[3], const float add[3])
+{
+    int x = 0;
+#if CV_SIMD
+    const int lanes = cv::VTraits<cv::v_uint8>::vlanes(), quarter = cv::VTraits<cv::v_float32>::vlanes();
+    cv::v_float32 vm[3], va[3];
+    for (int c = 0; c < 3; c++)
+    {
+        vm[c] = cv::vx_setall_f32(mul[c]);
+        va[c] = cv::vx_setall_f32(add[c]);
+    }
+
+    for (; x <= width - lanes; x += lanes)
+    {
+        cv::v_uint8 ch[3];
+        cv::v_load_deinterleave(src + x * 3, ch[0], ch[1], ch[2]);
+        float *out[3] = {outB + x, outG + x, outR + x};
+
+        for (int c = 0; c < 3; c++)
+        {
+            cv::v_uint16 half[2];
+            cv::v_uint32 part[4];
+            cv::v_expand(ch[c], half[0], half[1]);
+            cv::v_expand(half[0], part[0], part[1]);
+            cv::v_expand(half[1], part[2], part[3]);
+
+            for (int q = 0; q < 4; q++)
+            {
+                cv::v_float32 v = cv::v_cvt_f32(cv::v_reinterpret_as_s32(part[q]));
+                v = (N == normMode::SCALE) ? cv::v_mul(v, vm[c]) : cv::v_fma(v, vm[c], va[c]);
+                cv::v_store(out[c] + q * quarter, v);
+            }
+        }
+    }
+    cv::vx_cleanup();
+#endif
+    for (; x < width; x++)
+    {
+        const uchar *p = src + x * 3;
+        if (N == normMode::SCALE)
+        {
+            outB[x] = p[0] * mul[0];
+            outG[x] = p[1] * mul[0];
+            outR[x] = p[2] * mul[0];
+        }
+        else
+        {
+            outB[x] = p[0] * mul[0] + add[0];
+            outG[x] = p[1] * mul[1] + add[1];
+            outR[x] = p[2] * mul[2] + add[2];
+        }
+    }
+}
+
+// Horizontal blend of a float BGR row, normalization and channel split
+template <normMode N>
+static void blendColumns(const float *row, const int *xofs, const float *xalpha, float *outB, float *outG, float *outR,
+                         int width, const float mul[3], const float add[3])
+{
+    int x = 0;
+#if CV_SIMD
+    // Both neighbours of every column are gathered by their element offset, channel by channel
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    cv::v_float32 vm[3], va[3];
+    for (int c = 0; c < 3; c++)
+    {
+        vm[c] = cv::vx_setall_f32(N == normMode::SCALE ? mul[0] : mul[c]);
+        va[c] = cv::vx_setall_f32(add[c]);
+    }
+
+    float *out[3] = {outB, outG, outR};
+    for (; x <= width - lanes; x += lanes)
+    {
+        cv::v_float32 a = cv::vx_load(xalpha + x);
+        for (int c = 0; c < 3; c++)
+        {
+            cv::v_float32 p0 = cv::v_lut(row + c, xofs + x);
+            cv::v_float32 p1 = cv::v_lut(row + c + 3, xofs + x);
+            cv::v_float32 v = cv::v_fma(cv::v_sub(p1, p0), a, p0);
+            v = (N == normMode::SCALE) ? cv::v_mul(v, vm[c]) : cv::v_fma(v, vm[c], va[c]);
+            cv::v_store(out[c] + x, v);
+        }
+    }
+    cv::vx_cleanup();
+#endif
+    for (; x < width; x++)
+    {
+        const float *p = row + xofs[x];
+        float a = xalpha[x];
+        float b = p[0] + a * (p[3] - p[0]);
+        float g = p[1] + a * (p[4] - p[1]);
+        float r = p[2] + a * (p[5] - p[2]);
+
+        if (N == normMode::SCALE)
+        {
+            outB[x] = b * mul[0];
+            outG[x] = g * mul[0];
+            outR[x] = r * mul[0];
+        }
+        else
+        {
+            outB[x] = b * mul[0] + add[0];
+            outG[x] = g * mul[1] + add[1];
+            outR[x] = r * mul[2] + add[2];
+        }
+    }
+}
+
+template <class Policy>
+void FusedLetterbox::runPolicy(const cv::Mat &src, float *dst, int begin, int end) const
+{
+    // Constexpr shape when policy has one, so the compiler knows trip counts of row loops
+    const int canvasWidth = Policy::width ? Policy::width : canvas.width;
+    const int canvasHeight = Policy::height ? Policy::height : canvas.height;
+    const int planeSize = canvasWidth * canvasHeight;
+
+    // Without padding image covers the canvas, bottom right padding places it to the origin
+    const bool padded = Policy::pad != padMode::NONE;
+    const int left = (Policy::pad == padMode::CENTER) ? padLeft : 0;
+    const int top = (Policy::pad == padMode::CENTER) ? padTop : 0;
+    const int width = padded ? resized.width : canvasWidth;
+    const int height = padded ? resized.height : canvasHeight;
+    const int rowLen = srcSize.width * 3;
+
+    // Source B, G, R channels are written to planes 2, 1, 0 (BGR to RGB swap)
+    float *planes[3] = {dst + 2 * planeSize, dst + planeSize, dst};
+
+    float padValues[3];
+    for (int c = 0; c < 3; c++)
+        padValues[c] = padValue * mul[c] + add[c];
+
+    // Blended source row, one extra pixel so the last column can be blended with itself.
+    // Kept per thread, so it is allocated only when a wider image comes.
+    static thread_local vector<float> rowBuf;
+    float *row = nullptr;
+    if (Policy::resize == resizeMode::BILINEAR)
+    {
+        if (rowBuf.size() < (size_t)rowLen + 3)
+            rowBuf.resize(rowLen + 3);
+        row = rowBuf.data();
+    }
+
+    for (int y = begin; y < end; y++)
+    {
+        float *out[3] = {planes[0] + y * canvasWidth, planes[1] + y * canvasWidth, planes[2] + y * canvasWidth};
+        int ry = y - top;
+
+        // Row fully inside of padding
+        if (padded && (ry < 0 || ry >= height))
+        {
+            for (int c = 0; c < 3; c++)
+                fill(out[c], out[c] + canvasWidth, padValues[c]);
+            continue;
+        }
+
+        // Left and right padding
+        if (padded)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                fill(out[c], out[c] + left, padValues[c]);
+                fill(out[c] + left + width, out[c] + canvasWidth, padValues[c]);
+            }
+        }
+
+        float *outR = out[2] + left, *outG = out[1] + left, *outB = out[0] + left;
+
+        // Same size, pixels are only split into planes and normalized
+        if (Policy::resize == resizeMode::NONE)
+        {
+            convertRow<Policy::norm>(src.ptr<uchar>(ry), outB, outG, outR, width, mul, add);
+            continue;
+        }
+
+        int sy = yofs[ry];
+        blendRows(src.ptr<uchar>(sy), src.ptr<uchar>(min(sy + 1, srcSize.height - 1)), yalpha[ry], row, rowLen);
+        row[rowLen] = row[rowLen - 3];
+        row[rowLen + 1] = row[rowLen - 2];
+        row[rowLen + 2] = row[rowLen - 1];
+
+        blendColumns<Policy::norm>(row, xofs.data(), xalpha.data(), outB, outG, outR, width, mul, add);
+    }
+}
+
+// BT.601 limited range, same coefficients as cv::COLOR_YUV2BGR_*
+static inline void yuvToBgr(int y, int u, int v, float *bgr)
+{
+    float luma = max(y - 16, 0) * 1.164f;
+    float du = (float)(u - 128), dv = (float)(v - 128);
+    bgr[0] = min(max(luma + 2.018f * du, 0.0f), 255.0f);
+    bgr[1] = min(max(luma - 0.813f * dv - 0.391f * du, 0.0f), 255.0f);
+    bgr[2] = min(max(luma + 1.596f * dv, 0.0f), 255.0f);
+}
+
+// Converts one source row of camera buffer into interleaved float BGR
+static void convertRawRow(const rawFrame &src, int y, float *out)
+{
+    const uchar *p0 = src.planes[0] + y * src.strides[0];
+
+    switch (src.fmt)
+    {
+    case rawFrame::NV12:
+    {
+        const uchar *uv = src.planes[1] + (y / 2) * src.strides[1];
+        for (int x = 0; x < src.width; x++)
+            yuvToBgr(p0[x], uv[x & ~1], uv[x | 1], out + x * 3);
+        break;
+    }
+    case rawFrame::I420:
+    {
+        const uchar *u = src.planes[1] + (y / 2) * src.strides[1];
+        const uchar *v = src.planes[2] + (y / 2) * src.strides[2];
+        for (int x = 0; x < src.width; x++)
+            yuvToBgr(p0[x], u[x / 2], v[x / 2], out + x * 3);
+        break;
+    }
+    case rawFrame::YUYV:
+        for (int x = 0; x < src.width; x++)
+            yuvToBgr(p0[x * 2], p0[(x & ~1) * 2 + 1], p0[(x & ~1) * 2 + 3], out + x * 3);
+        break;
+    case rawFrame::RGB_PLANAR:
+    {
+        const uchar *g = src.planes[1] + y * src.strides[1];
+        const uchar *b = src.planes[2] + y * src.strides[2];
+        for (int x = 0; x < src.width; x++)
+        {
+            out[x * 3] = b[x];
+            out[x * 3 + 1] = g[x];
+            out[x * 3 + 2] = p0[x];
+        }
+        break;
+    }
+    }
+
+    // One extra pixel, so the last column can be blended with itself
+    int len = src.width * 3;
+    out[len] = out[len - 3];
+    out[len + 1] = out[len - 2];
+    out[len + 2] = out[len - 1];
+}
+
+class rawLetterboxBody : public cv::ParallelLoopBody
+{
+public:
+    rawLetterboxBody(const FusedLetterbox &k, const rawFrame &s, float *d) : kernel(k), src(s), dst(d) {}
+
+    void operator()(const cv::Range &range) const override
+    {
+        kernel.runRawRows(src, dst, range.start, range.end);
+    }
+
+private:
+    const FusedLetterbox &kernel;
+    const rawFrame &src;
+    float *dst;
+};
+
+void FusedLetterbox::run(const rawFrame &src, float *dst) const
+{
+    cv::parallel_for_(cv::Range(0, canvas.height), rawLetterboxBody(*this, src, dst));
+}
+
+void FusedLetterbox::runRawRows(const rawFrame &src, float *dst, int begin, int end) const
+{
+    const int planeSize = canvas.area();
+    const int rowLen = srcSize.width * 3 + 3;
+    float *planes[3] = {dst + 2 * planeSize, dst + planeSize, dst};
+
+    float padValues[3];
+    for (int c = 0; c < 3; c++)
+        padValues[c] = padValue * mul[c] + add[c];
+
+    // Two converted source rows and the blended one, per thread. Neighbouring canvas rows mostly
+    // share source rows, so every source row is converted about once.
+    static thread_local vector<float> rawBuf;
+    if (rawBuf.size() < (size_t)rowLen * 3)
+        rawBuf.resize(rowLen * 3);
+    float *converted[2] = {rawBuf.data(), rawBuf.data() + rowLen};
+    float *row = rawBuf.data() + 2 * rowLen;
+    int convertedRow[2] = {-1, -1};
+
+    for (int y = begin; y < end; y++)
+    {
+        float *out[3] = {planes[0] + y * canvas.width, planes[1] + y * canvas.width, planes[2] + y * canvas.width};
+        int ry = y - padTop;
+
+        // Row fully inside of padding
+        if (ry < 0 || ry >= resized.height)
+        {
+            for (int c = 0; c < 3; c++)
+                fill(out[c], out[c] + canvas.width, padValues[c]);
+            continue;
+        }
+
+        for (int c = 0; c < 3; c++)
+        {
+            fill(out[c], out[c] + padLeft, padValues[c]);
+            fill(out[c] + padLeft + resized.width, out[c] + canvas.width, padValues[c]);
+        }
+
+        // Convert source rows which are not converted yet, reusing slot of the row no longer needed
+        int rows[2] = {yofs[ry], min(yofs[ry] + 1, srcSize.height - 1)};
+        for (int r = 0; r < 2; r++)
+        {
+            if (convertedRow[0] == rows[r] || convertedRow[1] == rows[r])
+                continue;
+
+            int slot = (convertedRow[0] == rows[1 - r]) ? 1 : 0;
+            convertRawRow(src, rows[r], converted[slot]);
+            convertedRow[slot] = rows[r];
+        }
+
+        const float *r0 = converted[convertedRow[0] == rows[0] ? 0 : 1];
+        const float *r1 = converted[convertedRow[0] == rows[1] ? 0 : 1];
+        float a = yalpha[ry];
+        for (int i = 0; i < rowLen; i++)
+            row[i] = r0[i] + a * (r1[i] - r0[i]);
+
+        blendColumns<normMode::AFFINE>(row, xofs.data(), xalpha.data(), out[0] + padLeft, out[1] + padLeft, out[2] + padLeft,
+                                       resized.width, mul, add);
+    }
+}
+
+// Dispatch, one level per policy parameter
+template <resizeMode R, padMode P, normMode N>
+FusedLetterbox::rowsKernel FusedLetterbox::shapeKernel(bool standard)
+{
+    if (standard)
+        return &FusedLetterbox::runPolicy<preprocessPolicy<R, P, N, STANDARD_WIDTH, STANDARD_HEIGHT>>;
+    return &FusedLetterbox::runPolicy<preprocessPolicy<R, P, N, 0, 0>>;
+}
+
+template <resizeMode R, padMode P>
+FusedLetterbox::rowsKernel FusedLetterbox::normKernel(bool scale, bool standard)
+{
+    return scale ? shapeKernel<R, P, normMode::SCALE>(standard) : shapeKernel<R, P, normMode::AFFINE>(standard);
+}
+
+template <resizeMode R>
+FusedLetterbox::rowsKernel FusedLetterbox::padKernel(padMode pad, bool scale, bool standard)
+{
+    switch (pad)
+    {
+    case padMode::NONE:
+        return normKernel<R, padMode::NONE>(scale, standard);
+    case padMode::BOTTOM_RIGHT:
+        return normKernel<R, padMode::BOTTOM_RIGHT>(scale, standard);
+    default:
+        return normKernel<R, padMode::CENTER>(scale, standard);
+    }
+}
+
+void FusedLetterbox::selectKernel()
+{
+    // Policy parameters follow from geometry and normalization
+    bool same = (srcSize == resized);
+    padMode pad = padMode::CENTER;
+    if (resized == canvas)
+        pad = padMode::NONE;
+    else if (padLeft == 0 && padTop == 0)
+        pad = padMode::BOTTOM_RIGHT;
+
+    bool scale = add[0] == 0 && add[1] == 0 && add[2] == 0 && mul[0] == mul[1] && mul[1] == mul[2];
+    bool standard = canvas.width == STANDARD_WIDTH && canvas.height == STANDARD_HEIGHT;
+
+    kernel = same ? padKernel<resizeMode::NONE>(pad, scale, standard) : padKernel<resizeMode::BILINEAR>(pad, scale, standard);
+
+    const char *padNames[3] = {"none", "bottom-right", "center"};
+    snprintf(kernelLabel, sizeof(kernelLabel), "%s/%s/%s/%s", same ? "none" : "bilinear", padNames[(int)pad],
+             scale ? "scale" : "affine", standard ? "640x640" : "dynamic");
+}
@@ -0,0 +1,62 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/InferenceBackend.hpp"
+#include <algorithm>
+
+// Defined by the backend sources, optional ones are compiled only when enabled
+unique_ptr<InferenceBackend> createOpenCVBackend(const InferenceBackend::options &opts);
+#ifdef YOLONAS_WITH_ONNXRUNTIME
+unique_ptr<InferenceBackend> createOnnxRuntimeBackend(const InferenceBackend::options &opts);
+#endif
+#ifdef YOLONAS_WITH_OPENVINO
+unique_ptr<InferenceBackend> createOpenVINOBackend(const InferenceBackend::options &opts);
+#endif
+
+unique_ptr<InferenceBackend> InferenceBackend::create(const string &name, const options &opts)
+{
+    if (name == "opencv")
+        return createOpenCVBackend(opts);
+#ifdef YOLONAS_WITH_ONNXRUNTIME
+    if (name == "onnxruntime")
+        return createOnnxRuntimeBackend(opts);
+#endif
+#ifdef YOLONAS_WITH_OPENVINO
+    if (name == "openvino")
+        return createOpenVINOBackend(opts);
+#endif
+
+    return unique_ptr<InferenceBackend>();
+}
+
+vector<string> InferenceBackend::available()
+{
+    vector<string> names{"opencv"};
+#ifdef YOLONAS_WITH_ONNXRUNTIME
+    names.push_back("onnxruntime");
+#endif
+#ifdef YOLONAS_WITH_OPENVINO
+    names.push_back("openvino");
+#endif
+
+    return names;
+}
+
+void InferenceBackend::orderOutputs(vector<vector<cv::Mat>> &outputs)
+{
+    if (outputs.size() != 2)
+        return;
+
+    cv::Mat &first = outputs[0][0], &second = outputs[1][0];
+    if (first.size[first.dims - 1] == 4 && second.size[second.dims - 1] != 4)
+        swap(outputs[0], outputs[1]);
+}
+
+void InferenceBackend::orderDepths(vector<int> &depths, const vector<int64_t> &lastDims)
+{
+    if (depths.size() != 2 || lastDims.size() != 2)
+        return;
+
+    if (lastDims[0] == 4 && lastDims[1] != 4)
+        swap(depths[0], depths[1]);
+}
@@ -0,0 +1,136 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/ModelBundle.hpp"
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(ModelBundle::bundleHeader) == 128, "bundle header has to match the file layout");
+static_assert(offsetof(ModelBundle::bundleHeader, headerChecksum) == 112, "header checksum has to match the file layout");
+
+ModelBundle::~ModelBundle()
+{
+    if (mapping)
+        munmap((void *)mapping, mappingSize);
+}
+
+ModelBundle::loadResult ModelBundle::open(const string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return NOT_FOUND;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NOT_FOUND;
+    }
+
+    // Mapping stays valid after the descriptor is closed, pages are read only when network touches them
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NOT_FOUND;
+
+    mapping = (const char *)data;
+    mappingSize = st.st_size;
+
+    return parse();
+}
+
+ModelBundle::loadResult ModelBundle::parse()
+{
+    // Plain ONNX model, there is no bundle header
+    if (mappingSize < sizeof(bundleHeader) || memcmp(mapping, "YOLONAS\0", 8) != 0)
+        return LOADED;
+
+    memcpy(&head, mapping, sizeof(bundleHeader));
+    bundle = true;
+
+    if (head.version != VERSION)
+        return VERSION_UNSUPPORTED;
+
+    // Offsets and sizes are checked only when the header itself is intact
+    if (crc32(mapping, offsetof(bundleHeader, headerChecksum)) != head.headerChecksum)
+        return CORRUPTED;
+
+    // All sections have to lie inside of the file, compared so that offset + size cannot overflow
+    if (head.headerSize < sizeof(bundleHeader) || head.headerSize > mappingSize ||
+        head.labelsOffset > mappingSize || head.labelsSize > mappingSize - head.labelsOffset ||
+        head.modelOffset > mappingSize || head.modelSize > mappingSize - head.modelOffset)
+        return CORRUPTED;
+
+    if (crc32(mapping + head.headerSize, mappingSize - head.headerSize) != head.checksum)
+        return CORRUPTED;
+
+    // Label table
+    labelTable.clear();
+    size_t pos = head.labelsOffset, end = head.labelsOffset + head.labelsSize;
+    for (uint32_t i = 0; i < head.labelCount; i++)
+    {
+        uint32_t len;
+        if (pos + sizeof(len) > end)
+            return CORRUPTED;
+        memcpy(&len, mapping + pos, sizeof(len));
+        pos += sizeof(len);
+
+        if (pos + len > end)
+            return CORRUPTED;
+        labelTable.push_back(string(mapping + pos, len));
+        pos += len;
+    }
+
+    return LOADED;
+}
+
+bool ModelBundle::isBundle() const
+{
+    return bundle;
+}
+
+const ModelBundle::bundleHeader &ModelBundle::header() const
+{
+    return head;
+}
+
+const vector<string> &ModelBundle::labels() const
+{
+    return labelTable;
+}
+
+const char *ModelBundle::modelData() const
+{
+    return bundle ? mapping + head.modelOffset : mapping;
+}
+
+size_t ModelBundle::modelSize() const
+{
+    return bundle ? head.modelSize : mappingSize;
+}
+
+uint32_t ModelBundle::crc32(const char *data, size_t size)
+{
+    // Same CRC32 as zlib.crc32 of Python, table is built once
+    static const vector<uint32_t> table = []()
+    {
+        vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
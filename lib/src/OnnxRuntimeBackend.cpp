@@ -0,0 +1,139 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/InferenceBackend.hpp"
+#include <onnxruntime_cxx_api.h>
+
+// ONNX Runtime on CPU, built only with YOLONAS_WITH_ONNXRUNTIME
+class OnnxRuntimeBackend : public InferenceBackend
+{
+public:
+    OnnxRuntimeBackend(const options &o) : opts(o), memoryInfo(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {}
+
+    void load(const char *model, size_t size) override
+    {
+        Ort::SessionOptions sessionOptions;
+        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+        if (opts.threads > 0)
+            sessionOptions.SetIntraOpNumThreads(opts.threads);
+
+        // Inter-op threads are used only by parallel execution mode
+        if (opts.interOpThreads > 0)
+        {
+            sessionOptions.SetExecutionMode(ExecutionMode::ORT_PARALLEL);
+            sessionOptions.SetInterOpNumThreads(opts.interOpThreads);
+        }
+
+        session.reset(new Ort::Session(environment(), model, size, sessionOptions));
+
+        // Names are copied, as allocated ones are freed with their holders
+        Ort::AllocatorWithDefaultOptions allocator;
+        inputName = session->GetInputNameAllocated(0, allocator).get();
+        outputNames.clear();
+        for (size_t i = 0; i < session->GetOutputCount(); i++)
+            outputNames.push_back(session->GetOutputNameAllocated(i, allocator).get());
+
+        outputNamePtrs.clear();
+        for (auto &outputName : outputNames)
+            outputNamePtrs.push_back(outputName.c_str());
+
+        // Types are known from the model, last dimension orders them like the outputs
+        depths.clear();
+        vector<int64_t> lastDims;
+        for (size_t i = 0; i < session->GetOutputCount(); i++)
+        {
+            Ort::TypeInfo info = session->GetOutputTypeInfo(i);
+            auto tensorInfo = info.GetTensorTypeAndShapeInfo();
+            depths.push_back(toDepth(tensorInfo.GetElementType()));
+            lastDims.push_back(tensorInfo.GetShape().back());
+        }
+        orderDepths(depths, lastDims);
+    }
+
+    void setInput(cv::Mat &blob) override
+    {
+        input = blob;
+    }
+
+    void forward(vector<vector<cv::Mat>> &outputs) override
+    {
+        int64_t shape[4] = {input.size[0], input.size[1], input.size[2], input.size[3]};
+        Ort::Value tensor = Ort::Value::CreateTensor<float>(memoryInfo, input.ptr<float>(), input.total(), shape, 4);
+        const char *inputNamePtr = inputName.c_str();
+
+        // Results are kept until the next forward, Mats are only headers on their memory
+        results = session->Run(Ort::RunOptions{nullptr}, &inputNamePtr, &tensor, 1, outputNamePtrs.data(), outputNamePtrs.size());
+
+        outputs.resize(results.size());
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            auto info = results[i].GetTensorTypeAndShapeInfo();
+            vector<int64_t> dims = info.GetShape();
+            vector<int> sizes(dims.begin(), dims.end());
+
+            outputs[i].resize(1);
+            outputs[i][0] = cv::Mat(sizes, toDepth(info.GetElementType()), results[i].GetTensorMutableRawData());
+        }
+
+        orderOutputs(outputs);
+    }
+
+    vector<int> outputDepths() const override
+    {
+        return depths;
+    }
+
+    unique_ptr<InferenceBackend> clone() const override
+    {
+        return unique_ptr<InferenceBackend>(new OnnxRuntimeBackend(opts));
+    }
+
+    const char *name() const override
+    {
+        return "onnxruntime";
+    }
+
+private:
+    options opts;
+    Ort::MemoryInfo memoryInfo;
+    unique_ptr<Ort::Session> session;
+    string inputName;
+    vector<string> outputNames;
+    vector<const char *> outputNamePtrs;
+    cv::Mat input;
+    vector<Ort::Value> results;
+    vector<int> depths;
+
+    // Element types YoloNAS::infer converts to float
+    static int toDepth(ONNXTensorElementDataType type)
+    {
+        switch (type)
+        {
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+            return CV_32F;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+            return CV_16F;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+            return CV_8S;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+            return CV_8U;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+            return CV_32S;
+        default:
+            throw runtime_error("UNSUPPORTED_OUTPUT_TYPE");
+        }
+    }
+
+    // One environment for the whole process, shared by all sessions
+    static Ort::Env &environment()
+    {
+        static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "yolonas");
+        return env;
+    }
+};
+
+unique_ptr<InferenceBackend> createOnnxRuntimeBackend(const InferenceBackend::options &opts)
+{
+    return unique_ptr<InferenceBackend>(new OnnxRuntimeBackend(opts));
+}
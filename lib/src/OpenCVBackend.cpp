@@ -0,0 +1,90 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/InferenceBackend.hpp"
+#include <opencv2/dnn.hpp>
+
+// Default backend, OpenCV DNN on CPU or CUDA
+class OpenCVBackend : public InferenceBackend
+{
+public:
+    OpenCVBackend(const options &o) : opts(o) {}
+
+    void load(const char *model, size_t size) override
+    {
+        net = cv::dnn::readNetFromONNX(model, size);
+        depths.clear();
+
+        // Set the preferable backend and target based on CUDA availability, INT8 layers run only on CPU
+        if (opts.cuda && cv::cuda::getCudaEnabledDeviceCount() > 0 && !hasInt8Layers())
+        {
+            net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
+            net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+        }
+        else
+        {
+            net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+            net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        }
+
+        // OpenCV has only one (global) thread pool, inter-op parallelism is not supported
+        if (opts.threads > 0)
+            cv::setNumThreads(opts.threads);
+
+        // Output names are asked once, as every call allocates them
+        outNames = net.getUnconnectedOutLayersNames();
+    }
+
+    void setInput(cv::Mat &blob) override
+    {
+        net.setInput(blob);
+    }
+
+    void forward(vector<vector<cv::Mat>> &outputs) override
+    {
+        net.forward(outputs, outNames);
+
+        // Types are known only from the produced outputs
+        if (depths.empty())
+            for (auto &output : outputs)
+                depths.push_back(output[0].depth());
+    }
+
+    vector<int> outputDepths() const override
+    {
+        return depths;
+    }
+
+    unique_ptr<InferenceBackend> clone() const override
+    {
+        return unique_ptr<InferenceBackend>(new OpenCVBackend(opts));
+    }
+
+    const char *name() const override
+    {
+        return "opencv";
+    }
+
+private:
+    options opts;
+    cv::dnn::Net net;
+    vector<cv::String> outNames;
+    vector<int> depths;
+
+    // Imported quantized layers (QDQ and QOperator graphs) have Int8 types in OpenCV
+    bool hasInt8Layers() const
+    {
+        vector<cv::String> types;
+        net.getLayerTypes(types);
+        for (auto &type : types)
+            if (type.find("Int8") != cv::String::npos || type.find("Quantize") != cv::String::npos)
+                return true;
+
+        return false;
+    }
+};
+
+unique_ptr<InferenceBackend> createOpenCVBackend(const InferenceBackend::options &opts)
+{
+    return unique_ptr<InferenceBackend>(new OpenCVBackend(opts));
+}
@@ -0,0 +1,153 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/InferenceBackend.hpp"
+#include <openvino/openvino.hpp>
+#include <openvino/frontend/manager.hpp>
+#include <istream>
+#include <streambuf>
+
+// Read only stream over the model in memory, so the ONNX frontend parses the mapping without a copy of it
+class memoryStreamBuffer : public streambuf
+{
+public:
+    memoryStreamBuffer(const char *data, size_t size)
+    {
+        char *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, ios_base::seekdir dir, ios_base::openmode) override
+    {
+        char *base = (dir == ios_base::beg) ? eback() : (dir == ios_base::cur) ? gptr() : egptr();
+        if (off < eback() - base || off > egptr() - base)
+            return pos_type(off_type(-1));
+
+        setg(eback(), base + off, egptr());
+        return pos_type(gptr() - eback());
+    }
+
+    pos_type seekpos(pos_type pos, ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), ios_base::beg, which);
+    }
+};
+
+// OpenVINO on CPU, built only with YOLONAS_WITH_OPENVINO
+class OpenVINOBackend : public InferenceBackend
+{
+public:
+    OpenVINOBackend(const options &o) : opts(o) {}
+
+    void load(const char *model, size_t size) override
+    {
+        // ONNX frontend reads the model straight from memory, weights are part of it. Core::read_model takes
+        // the model only as string, which would copy the whole (possibly mapped) file.
+        memoryStreamBuffer buffer(model, size);
+        istream stream(&buffer);
+        istream *streamPtr = &stream;
+
+        ov::frontend::FrontEndManager manager;
+        ov::frontend::FrontEnd::Ptr frontEnd = manager.load_by_model(streamPtr);
+        if (!frontEnd)
+            throw runtime_error("MODEL_LOADING_FAILED");
+        shared_ptr<ov::Model> network = frontEnd->convert(frontEnd->load(streamPtr));
+
+        ov::AnyMap config{ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)};
+        if (opts.threads > 0)
+            config.insert(ov::inference_num_threads(opts.threads));
+        if (opts.interOpThreads > 0)
+            config.insert(ov::num_streams(opts.interOpThreads));
+
+        compiled = core().compile_model(network, "CPU", config);
+        request = compiled.create_infer_request();
+
+        // Types are known from the compiled model, last dimension orders them like the outputs
+        depths.clear();
+        vector<int64_t> lastDims;
+        for (auto &output : compiled.outputs())
+        {
+            depths.push_back(toDepth(output.get_element_type()));
+            ov::PartialShape shape = output.get_partial_shape();
+            lastDims.push_back(shape[shape.size() - 1].is_static() ? shape[shape.size() - 1].get_length() : -1);
+        }
+        orderDepths(depths, lastDims);
+    }
+
+    void setInput(cv::Mat &blob) override
+    {
+        // Tensor wraps memory of the blob, nothing is copied
+        ov::Shape shape{(size_t)blob.size[0], (size_t)blob.size[1], (size_t)blob.size[2], (size_t)blob.size[3]};
+        request.set_input_tensor(ov::Tensor(ov::element::f32, shape, blob.ptr<float>()));
+    }
+
+    void forward(vector<vector<cv::Mat>> &outputs) override
+    {
+        request.infer();
+
+        // Mats are only headers on output tensors of the request, valid until the next forward
+        outputs.resize(compiled.outputs().size());
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            ov::Tensor result = request.get_output_tensor(i);
+            ov::Shape dims = result.get_shape();
+            vector<int> sizes(dims.begin(), dims.end());
+
+            outputs[i].resize(1);
+            outputs[i][0] = cv::Mat(sizes, toDepth(result.get_element_type()), result.data());
+        }
+
+        orderOutputs(outputs);
+    }
+
+    vector<int> outputDepths() const override
+    {
+        return depths;
+    }
+
+    unique_ptr<InferenceBackend> clone() const override
+    {
+        return unique_ptr<InferenceBackend>(new OpenVINOBackend(opts));
+    }
+
+    const char *name() const override
+    {
+        return "openvino";
+    }
+
+private:
+    options opts;
+    ov::CompiledModel compiled;
+    ov::InferRequest request;
+    vector<int> depths;
+
+    // Element types YoloNAS::infer converts to float
+    static int toDepth(const ov::element::Type &type)
+    {
+        if (type == ov::element::f32)
+            return CV_32F;
+        if (type == ov::element::f16)
+            return CV_16F;
+        if (type == ov::element::i8)
+            return CV_8S;
+        if (type == ov::element::u8)
+            return CV_8U;
+        if (type == ov::element::i32)
+            return CV_32S;
+
+        throw runtime_error("UNSUPPORTED_OUTPUT_TYPE");
+    }
+
+    // Core caches loaded plugins, so it is shared by all backends
+    static ov::Core &core()
+    {
+        static ov::Core instance;
+        return instance;
+    }
+};
+
+unique_ptr<InferenceBackend> createOpenVINOBackend(const InferenceBackend::options &opts)
+{
+    return unique_ptr<InferenceBackend>(new OpenVINOBackend(opts));
+}
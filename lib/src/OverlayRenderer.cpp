@@ -0,0 +1,216 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/OverlayRenderer.hpp"
+#include <cmath>
+#include <cstring>
+
+static const char TRACK_CHARS[] = "#0123456789";
+
+OverlayRenderer::OverlayRenderer(float boxAlpha, int lineThickness, double fontScale)
+    : alpha(min(max(boxAlpha, 0.0f), 1.0f)), thickness(max(lineThickness, 1)), scale(fontScale)
+{
+    // All glyphs share the height of the tallest text, so they can be placed side by side
+    cv::Size size = cv::getTextSize("Ag%#", cv::FONT_HERSHEY_SIMPLEX, scale, 1, &glyphBaseline);
+    glyphHeight = size.height + glyphBaseline + 4;
+
+    for (int s = 0; s <= 100; s++)
+        scoreGlyphs.push_back(rasterize(" " + to_string(s) + "%"));
+    for (int c = 0; TRACK_CHARS[c]; c++)
+        trackGlyphs.push_back(rasterize(string(1, TRACK_CHARS[c])));
+}
+
+OverlayRenderer::~OverlayRenderer()
+{
+    stop();
+}
+
+cv::Mat OverlayRenderer::rasterize(const string &text)
+{
+    int baseline;
+    cv::Size size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, scale, 1, &baseline);
+
+    cv::Mat glyph = cv::Mat::zeros(glyphHeight, size.width + 4, CV_8UC1);
+    cv::putText(glyph, text, cv::Point(2, glyphHeight - glyphBaseline - 2), cv::FONT_HERSHEY_SIMPLEX, scale, cv::Scalar(255), 1, cv::LINE_AA);
+    return glyph;
+}
+
+const cv::Mat &OverlayRenderer::labelGlyph(int classId, const char *label)
+{
+    if ((size_t)classId >= labelGlyphs.size())
+        labelGlyphs.resize(classId + 1);
+
+    // Label of a class does not change, so it is rasterized on its first detection
+    if (labelGlyphs[classId].empty())
+        labelGlyphs[classId] = rasterize(label ? label : to_string(classId));
+    return labelGlyphs[classId];
+}
+
+void OverlayRenderer::setClassColor(int classId, cv::Scalar color)
+{
+    classColor(classId);
+    colors[classId] = color;
+}
+
+cv::Scalar OverlayRenderer::classColor(int classId)
+{
+    classId = max(classId, 0);
+    while ((size_t)classId >= colors.size())
+    {
+        // Hues spread by golden ratio, so neighbouring classes differ, converted from HSV (s = 0.8, v = 1)
+        float h = fmod(colors.size() * 0.618034f, 1.0f) * 6;
+        int sector = (int)h;
+        float f = h - sector, p = 0.2f, q = 1 - 0.8f * f, t = 1 - 0.8f * (1 - f);
+        float rgb[6][3] = {{1, t, p}, {q, 1, p}, {p, 1, t}, {p, q, 1}, {t, p, 1}, {1, p, q}};
+        float *c = rgb[sector % 6];
+
+        colors.push_back(cv::Scalar(c[2] * 255, c[1] * 255, c[0] * 255));
+    }
+    return colors[classId];
+}
+
+void OverlayRenderer::drawTag(cv::Mat &output, const YoloNAS::detectionInfo &detection, const cv::Scalar &color)
+{
+    // Glyphs of label, score and track id are placed into one mask
+    const cv::Mat &label = labelGlyph(detection.classId, detection.label);
+    const cv::Mat &score = scoreGlyphs[min(max((int)(detection.score * 100), 0), 100)];
+
+    int width = label.cols + score.cols;
+    string track = (detection.trackId >= 0) ? "#" + to_string(detection.trackId) : "";
+    for (char c : track)
+        width += trackGlyphs[strchr(TRACK_CHARS, c) - TRACK_CHARS].cols;
+
+    tag.create(glyphHeight, width, CV_8UC1);
+    int x = 0;
+    label.copyTo(tag(cv::Rect(x, 0, label.cols, glyphHeight)));
+    x += label.cols;
+    for (char c : track)
+    {
+        const cv::Mat &glyph = trackGlyphs[strchr(TRACK_CHARS, c) - TRACK_CHARS];
+        glyph.copyTo(tag(cv::Rect(x, 0, glyph.cols, glyphHeight)));
+        x += glyph.cols;
+    }
+    score.copyTo(tag(cv::Rect(x, 0, score.cols, glyphHeight)));
+
+    // Above the box, or inside of it at the top edge of the frame
+    int top = (detection.y - glyphHeight >= 0) ? detection.y - glyphHeight : detection.y;
+    cv::Rect place = cv::Rect(detection.x, top, width, glyphHeight) & cv::Rect(0, 0, output.cols, output.rows);
+    if (place.empty())
+        return;
+
+    // White text on class colored background
+    for (int y = 0; y < place.height; y++)
+    {
+        const uchar *m = tag.ptr<uchar>(place.y - top + y) + (place.x - detection.x);
+        uchar *out = output.ptr<uchar>(place.y + y) + place.x * 3;
+        for (int i = 0; i < place.width; i++)
+        {
+            int a = m[i];
+            out[i * 3] = (uchar)((color[0] * (255 - a) + 255 * a) / 255);
+            out[i * 3 + 1] = (uchar)((color[1] * (255 - a) + 255 * a) / 255);
+            out[i * 3 + 2] = (uchar)((color[2] * (255 - a) + 255 * a) / 255);
+        }
+    }
+}
+
+void OverlayRenderer::render(const cv::Mat &frame, const vector<YoloNAS::detectionInfo> &detections, cv::Mat &output)
+{
+    if (output.data != frame.data)
+        frame.copyTo(output);
+
+    // Only 8-bit BGR output is drawn
+    if (output.type() != CV_8UC3)
+        return;
+
+    cv::Rect frameRect(0, 0, output.cols, output.rows);
+    for (auto &detection : detections)
+    {
+        cv::Rect box = cv::Rect(detection.x, detection.y, detection.w, detection.h) & frameRect;
+        if (box.empty())
+            continue;
+
+        cv::Scalar color = classColor(detection.classId);
+
+        // Translucent fill only over the box, full frame is never blended
+        if (alpha > 0)
+        {
+            cv::Mat roi = output(box);
+            fill.create(box.size(), CV_8UC3);
+            fill.setTo(color);
+            cv::addWeighted(roi, 1 - alpha, fill, alpha, 0, roi);
+        }
+
+        cv::rectangle(output, box, color, thickness);
+        drawTag(output, detection, color);
+    }
+}
+
+void OverlayRenderer::start()
+{
+    lock_guard<mutex> guard(lock);
+    if (running)
+        return;
+
+    running = true;
+    worker = thread(&OverlayRenderer::workerLoop, this);
+}
+
+void OverlayRenderer::submit(const cv::Mat &frame, const vector<YoloNAS::detectionInfo> &detections)
+{
+    {
+        // Frame not drawn yet is overwritten, pending buffer keeps its allocation
+        lock_guard<mutex> guard(lock);
+        frame.copyTo(pending);
+        pendingDetections.assign(detections.begin(), detections.end());
+        pendingReady = true;
+    }
+    wake.notify_one();
+}
+
+bool OverlayRenderer::latest(cv::Mat &output)
+{
+    lock_guard<mutex> guard(lock);
+    if (!drawnReady)
+        return false;
+
+    // Swap hands the drawn buffer over, caller's old buffer is reused for the next frame
+    cv::swap(output, drawn);
+    drawnReady = false;
+    return true;
+}
+
+void OverlayRenderer::stop()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        if (!running)
+            return;
+        running = false;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void OverlayRenderer::workerLoop()
+{
+    unique_lock<mutex> guard(lock);
+    while (true)
+    {
+        wake.wait(guard, [&]
+                  { return pendingReady || !running; });
+        if (!running)
+            break;
+
+        cv::swap(pending, drawing);
+        drawingDetections.swap(pendingDetections);
+        pendingReady = false;
+
+        // Drawing happens in place, outside of the lock
+        guard.unlock();
+        render(drawing, drawingDetections, drawing);
+        guard.lock();
+
+        cv::swap(drawing, drawn);
+        drawnReady = true;
+    }
+}
@@ -0,0 +1,207 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/Postprocessor.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+
+void Postprocessor::setTopK(int k)
+{
+    topK = max(k, 0);
+}
+
+void Postprocessor::setClassAware(bool enabled)
+{
+    classAware = enabled;
+}
+
+float Postprocessor::rowMax(const float *row, int len)
+{
+    int i = 0;
+    float result = -FLT_MAX;
+#if CV_SIMD
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    if (len >= lanes)
+    {
+        cv::v_float32 vmax = cv::vx_load(row);
+        for (i = lanes; i <= len - lanes; i += lanes)
+            vmax = cv::v_max(vmax, cv::vx_load(row + i));
+        result = cv::v_reduce_max(vmax);
+    }
+    cv::vx_cleanup();
+#endif
+    for (; i < len; i++)
+        result = max(result, row[i]);
+
+    return result;
+}
+
+void Postprocessor::run(const float *scores,
+                        const float *bboxes,
+                        int anchors,
+                        int classes,
+                        float scoreThresh,
+                        float iouThresh,
+                        vector<cv::Rect> &boxesOut,
+                        vector<int> &labelsOut,
+                        vector<float> &scoresOut,
+                        vector<int> &suppressedObjs)
+{
+    boxesOut.clear();
+    labelsOut.clear();
+    scoresOut.clear();
+    suppressedObjs.clear();
+
+    for (int i = 0; i < anchors; i++)
+    {
+        const float *row = scores + (size_t)i * classes;
+
+        // Reject anchor early, as most of them are under the threshold (same as NMSBoxes, equal score is rejected).
+        // Written as negation, so NaN scores of broken FP16 or INT8 outputs are rejected too.
+        float score = rowMax(row, classes);
+        if (!(score > scoreThresh))
+            continue;
+
+        // Class is first one with the maximum score (same as cv::minMaxLoc), search stays inside of the row
+        int classID = 0;
+        while (classID < classes && row[classID] != score)
+            classID++;
+        if (classID == classes)
+            continue;
+
+        // Convert coordinates to ints only for the candidates
+        const float *box = bboxes + (size_t)i * 4;
+        int x1 = cvRound(box[0]), y1 = cvRound(box[1]), x2 = cvRound(box[2]), y2 = cvRound(box[3]);
+
+        // Store the results
+        labelsOut.push_back(classID);
+        scoresOut.push_back(score);
+        boxesOut.push_back(cv::Rect(x1, y1, x2 - x1, y2 - y1));
+    }
+
+    // Apply non-maximum suppression to remove redundant detections
+    runNMS(boxesOut, labelsOut, scoresOut, iouThresh, suppressedObjs);
+}
+
+void Postprocessor::runNMS(vector<cv::Rect> &boxes, vector<int> &labels, vector<float> &scores, float iouThresh, vector<int> &keep)
+{
+    int count = (int)boxes.size();
+
+    // Sort candidates by score, keeping only top K of them if requested
+    order.resize(count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+
+    // Equal scores keep candidate order (same as stable sort of NMSBoxes, without its temporary buffer)
+    auto byScore = [&](int a, int b)
+    {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    };
+
+    if (topK > 0 && topK < count)
+    {
+        partial_sort(order.begin(), order.begin() + topK, order.end(), byScore);
+        order.resize(topK);
+    }
+    else
+    {
+        sort(order.begin(), order.end(), byScore);
+    }
+
+    // Greedy NMS, every kept box suppresses overlapping lower scored boxes
+    suppressed.assign(order.size(), 0);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        if (suppressed[i])
+            continue;
+
+        int a = order[i];
+        keep.push_back(a);
+
+        const cv::Rect &boxA = boxes[a];
+        float areaA = (float)boxA.area();
+
+        for (size_t j = i + 1; j < order.size(); j++)
+        {
+            int b = order[j];
+            if (suppressed[j] || (classAware && labels[a] != labels[b]))
+                continue;
+
+            const cv::Rect &boxB = boxes[b];
+            float inter = (float)(boxA & boxB).area();
+            float iou = inter / (areaA + boxB.area() - inter);
+
+            if (iou > iouThresh)
+                suppressed[j] = 1;
+        }
+    }
+}
+
+void Postprocessor::merge(vector<cv::Rect> &boxes,
+                          vector<int> &labels,
+                          vector<float> &scores,
+                          float overlapThresh,
+                          bool weighted,
+                          vector<int> &keep)
+{
+    int count = (int)boxes.size();
+    keep.clear();
+
+    // Sort all boxes by score, there is no top K when merging
+    order.resize(count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+
+    auto byScore = [&](int a, int b)
+    {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    };
+    sort(order.begin(), order.end(), byScore);
+
+    // Greedy clustering, every kept box absorbs overlapping lower scored boxes of the same class
+    suppressed.assign(order.size(), 0);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        if (suppressed[i])
+            continue;
+
+        int a = order[i];
+        keep.push_back(a);
+
+        const cv::Rect boxA = boxes[a];
+        float areaA = (float)boxA.area();
+
+        // Score weighted sums of cluster corners
+        float weight = scores[a];
+        float x1 = boxA.x * weight, y1 = boxA.y * weight;
+        float x2 = boxA.br().x * weight, y2 = boxA.br().y * weight;
+
+        for (size_t j = i + 1; j < order.size(); j++)
+        {
+            int b = order[j];
+            if (suppressed[j] || labels[a] != labels[b])
+                continue;
+
+            const cv::Rect &boxB = boxes[b];
+            float inter = (float)(boxA & boxB).area();
+            float smaller = min(areaA, (float)boxB.area());
+
+            if (smaller <= 0 || inter / smaller <= overlapThresh)
+                continue;
+
+            suppressed[j] = 1;
+
+            if (weighted)
+            {
+                weight += scores[b];
+                x1 += boxB.x * scores[b];
+                y1 += boxB.y * scores[b];
+                x2 += boxB.br().x * scores[b];
+                y2 += boxB.br().y * scores[b];
+            }
+        }
+
+        if (weighted)
+            boxes[a] = cv::Rect(cv::Point(cvRound(x1 / weight), cvRound(y1 / weight)),
+                                cv::Point(cvRound(x2 / weight), cvRound(y2 / weight)));
+    }
+}
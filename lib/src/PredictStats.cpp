@@ -0,0 +1,105 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/PredictStats.hpp"
+#include <cstring>
+#include <sstream>
+
+StatsRecorder::StatsRecorder() : sequence(0)
+{
+    for (size_t i = 0; i < FIELDS; i++)
+        fields[i].store(0, memory_order_relaxed);
+}
+
+void StatsRecorder::record(const predictStats &last)
+{
+    // Only writer, so current totals can be read without the seqlock
+    predictStats st = snapshot();
+
+    st.preprocessNs = last.preprocessNs;
+    st.forwardNs = last.forwardNs;
+    st.postprocessNs = last.postprocessNs;
+    st.rescaleNs = last.rescaleNs;
+    st.painterNs = last.painterNs;
+    st.totalNs = last.totalNs;
+    st.candidates = last.candidates;
+    st.detections = last.detections;
+    st.bytesAllocated = last.bytesAllocated;
+
+    st.calls++;
+    st.preprocessNsTotal += last.preprocessNs;
+    st.forwardNsTotal += last.forwardNs;
+    st.postprocessNsTotal += last.postprocessNs;
+    st.rescaleNsTotal += last.rescaleNs;
+    st.painterNsTotal += last.painterNs;
+    st.totalNsTotal += last.totalNs;
+    st.candidatesTotal += last.candidates;
+    st.detectionsTotal += last.detections;
+    st.bytesAllocatedTotal += last.bytesAllocated;
+
+    uint64_t values[FIELDS];
+    memcpy(values, &st, sizeof(st));
+
+    // Odd sequence marks write in progress
+    uint64_t seq = sequence.load(memory_order_relaxed);
+    sequence.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < FIELDS; i++)
+        fields[i].store(values[i], memory_order_relaxed);
+
+    sequence.store(seq + 2, memory_order_release);
+}
+
+predictStats StatsRecorder::snapshot() const
+{
+    uint64_t values[FIELDS];
+    uint64_t before, after;
+
+    do
+    {
+        before = sequence.load(memory_order_acquire);
+        for (size_t i = 0; i < FIELDS; i++)
+            values[i] = fields[i].load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        after = sequence.load(memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    predictStats st;
+    memcpy(&st, values, sizeof(st));
+    return st;
+}
+
+string StatsRecorder::prometheus(const predictStats &st)
+{
+    ostringstream out;
+    const char *stages[] = {"preprocess", "forward", "postprocess", "rescale", "painter", "total"};
+    const uint64_t last[] = {st.preprocessNs, st.forwardNs, st.postprocessNs, st.rescaleNs, st.painterNs, st.totalNs};
+    const uint64_t total[] = {st.preprocessNsTotal, st.forwardNsTotal, st.postprocessNsTotal, st.rescaleNsTotal, st.painterNsTotal, st.totalNsTotal};
+
+    out << "# HELP yolonas_predict_calls_total Number of predict calls.\n"
+        << "# TYPE yolonas_predict_calls_total counter\n"
+        << "yolonas_predict_calls_total " << st.calls << "\n";
+
+    out << "# HELP yolonas_stage_seconds_total Time spent in predict stages.\n"
+        << "# TYPE yolonas_stage_seconds_total counter\n";
+    for (int i = 0; i < 6; i++)
+        out << "yolonas_stage_seconds_total{stage=\"" << stages[i] << "\"} " << total[i] / 1e9 << "\n";
+
+    out << "# HELP yolonas_stage_last_seconds Time spent in predict stages by the last call.\n"
+        << "# TYPE yolonas_stage_last_seconds gauge\n";
+    for (int i = 0; i < 6; i++)
+        out << "yolonas_stage_last_seconds{stage=\"" << stages[i] << "\"} " << last[i] / 1e9 << "\n";
+
+    out << "# HELP yolonas_candidates_total Anchors above score threshold.\n"
+        << "# TYPE yolonas_candidates_total counter\n"
+        << "yolonas_candidates_total " << st.candidatesTotal << "\n"
+        << "# HELP yolonas_detections_total Detections surviving NMS.\n"
+        << "# TYPE yolonas_detections_total counter\n"
+        << "yolonas_detections_total " << st.detectionsTotal << "\n"
+        << "# HELP yolonas_allocated_bytes_total Bytes allocated for library buffers.\n"
+        << "# TYPE yolonas_allocated_bytes_total counter\n"
+        << "yolonas_allocated_bytes_total " << st.bytesAllocatedTotal << "\n";
+
+    return out.str();
+}
@@ -0,0 +1,365 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/StreamScheduler.hpp"
+
+StreamScheduler::StreamScheduler(YoloNAS &detector, double latencySlo, int batch, float scoreThresh)
+    : net(detector), slo(latencySlo), maxBatch(max(batch, 1)), score(scoreThresh)
+{
+    batchLatency.assign(maxBatch + 1, 0);
+}
+
+StreamScheduler::~StreamScheduler()
+{
+    stop();
+
+    vector<int> ids;
+    {
+        lock_guard<mutex> guard(lock);
+        for (auto &s : streams)
+            ids.push_back(s.first);
+    }
+    for (int id : ids)
+        removeStream(id);
+}
+
+int StreamScheduler::addStream(frameSource source, resultCallback callback, double targetFps, int weight)
+{
+    shared_ptr<stream> s = make_shared<stream>();
+    s->source = source;
+    s->callback = callback;
+    s->period = (targetFps > 0) ? 1.0 / targetFps : 0;
+    s->weight = max(weight, 1);
+    s->nextDue = chrono::steady_clock::now();
+
+    {
+        lock_guard<mutex> guard(lock);
+        s->id = nextId++;
+
+        // New stream starts at the least served one, so it does not take over until it catches up
+        bool first = true;
+        for (auto &other : streams)
+        {
+            s->virtualTime = first ? other.second->virtualTime : min(s->virtualTime, other.second->virtualTime);
+            first = false;
+        }
+        streams[s->id] = s;
+    }
+
+    s->capture = thread(&StreamScheduler::captureLoop, this, s.get());
+    return s->id;
+}
+
+void StreamScheduler::removeStream(int id)
+{
+    shared_ptr<stream> s;
+    {
+        unique_lock<mutex> guard(lock);
+        auto it = streams.find(id);
+        if (it == streams.end())
+            return;
+
+        s = it->second;
+        s->stopped = true;
+        streams.erase(it);
+
+        // Scheduler may still hold the stream in the current round, its results are not delivered from now on.
+        // Callback already running is waited for, unless the stream is removed from within a callback.
+        if (this_thread::get_id() != scheduler.get_id())
+            callbackDone.wait(guard, [&]
+                              { return callingBack != id; });
+    }
+
+    // Capture thread sees the flag only between reads, so this waits for the source call in progress
+    s->capture.join();
+}
+
+void StreamScheduler::start()
+{
+    lock_guard<mutex> guard(lock);
+    if (running)
+        return;
+
+    running = true;
+    scheduler = thread(&StreamScheduler::schedulerLoop, this);
+}
+
+void StreamScheduler::stop()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        if (!running)
+            return;
+        running = false;
+    }
+    wake.notify_all();
+    scheduler.join();
+}
+
+StreamScheduler::streamStats StreamScheduler::stats(int id) const
+{
+    lock_guard<mutex> guard(lock);
+    auto it = streams.find(id);
+    if (it == streams.end())
+        return streamStats();
+
+    streamStats st = it->second->st;
+    st.meanLatency = st.processed ? it->second->latencySum / st.processed : 0;
+    return st;
+}
+
+void StreamScheduler::captureLoop(stream *s)
+{
+    cv::Mat frame;
+    while (true)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            if (s->stopped)
+                return;
+        }
+
+        // Source may block (network camera), so it is read outside of the lock
+        bool ok = s->source(frame);
+
+        {
+            lock_guard<mutex> guard(lock);
+            if (!ok)
+            {
+                s->st.finished = true;
+                return;
+            }
+
+            // Older frame which was not taken yet is replaced, its buffer is reused for the next read
+            if (s->fresh)
+                s->st.dropped++;
+            s->st.captured++;
+
+            cv::swap(frame, s->latest);
+            s->fresh = true;
+            s->capturedAt = chrono::steady_clock::now();
+        }
+        wake.notify_one();
+    }
+}
+
+double StreamScheduler::estimate(size_t size) const
+{
+    if (batchLatency[size] > 0)
+        return batchLatency[size];
+
+    // Not measured yet, so scaled from the closest smaller measured batch
+    for (size_t b = size - 1; b >= 1; b--)
+        if (batchLatency[b] > 0)
+            return batchLatency[b] * size / b;
+    return 0;
+}
+
+// Called with the lock held, takes the latest frames of the selected streams
+bool StreamScheduler::selectBatch(chrono::steady_clock::time_point &wakeAt)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    wakeAt = chrono::steady_clock::time_point::max();
+
+    candidates.clear();
+    for (auto &entry : streams)
+    {
+        stream &s = *entry.second;
+        if (!s.fresh)
+            continue;
+
+        // Stream above its target FPS waits, scheduler wakes up when it is due
+        if (s.period > 0 && now < s.nextDue)
+        {
+            wakeAt = min(wakeAt, s.nextDue);
+            continue;
+        }
+        candidates.push_back(entry.second);
+    }
+
+    if (candidates.empty())
+        return false;
+
+    // Weighted fair share: least served (per weight) first, older frame first among equal ones
+    sort(candidates.begin(), candidates.end(), [](const shared_ptr<stream> &a, const shared_ptr<stream> &b)
+         { return a->virtualTime != b->virtualTime ? a->virtualTime < b->virtualTime : a->capturedAt < b->capturedAt; });
+
+    // Largest batch whose oldest frame still meets the SLO after the estimated forward
+    size_t limit = min(candidates.size(), batchSupported ? (size_t)maxBatch : (size_t)1);
+    size_t size = 1;
+    chrono::steady_clock::time_point oldest = candidates[0]->capturedAt;
+    for (size_t b = 1; b <= limit; b++)
+    {
+        oldest = min(oldest, candidates[b - 1]->capturedAt);
+        double age = chrono::duration<double>(now - oldest).count();
+        if (b > 1 && age + estimate(b) > slo)
+            break;
+        size = b;
+    }
+
+    batch.assign(candidates.begin(), candidates.begin() + size);
+    frames.clear();
+    for (auto &s : batch)
+    {
+        cv::swap(s->latest, s->processing);
+        s->processingCapturedAt = s->capturedAt;
+        s->fresh = false;
+        s->virtualTime += 1.0 / s->weight;
+
+        // Keep the rhythm of target FPS, without bursts after the stream fell behind
+        if (s->period > 0)
+        {
+            s->nextDue += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(s->period));
+            if (s->nextDue < now)
+                s->nextDue = now;
+        }
+        frames.push_back(s->processing);
+    }
+
+    return true;
+}
+
+void StreamScheduler::schedulerLoop()
+{
+    unique_lock<mutex> guard(lock);
+    while (running)
+    {
+        chrono::steady_clock::time_point wakeAt;
+        if (!selectBatch(wakeAt))
+        {
+            if (wakeAt == chrono::steady_clock::time_point::max())
+                wake.wait(guard);
+            else
+                wake.wait_until(guard, wakeAt);
+            continue;
+        }
+
+        // Detector is used only by this thread, capture threads keep reading meanwhile
+        guard.unlock();
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+
+        results.clear();
+        bool batchRejected = false;
+        if (frames.size() > 1)
+        {
+            try
+            {
+                results = net.predictBatch(frames, false, score);
+            }
+            catch (exception &ex)
+            {
+                // Other failures are only retried frame by frame, batching stays enabled for next rounds
+                batchRejected = string(ex.what()) == "MODEL_DOES_NOT_SUPPORT_BATCH";
+            }
+        }
+        failed.assign(frames.size(), false);
+        if (results.size() != frames.size())
+        {
+            results.resize(frames.size());
+            bool anyFailed = false;
+            for (size_t i = 0; i < frames.size(); i++)
+            {
+                // Frame which throws (empty frame from the source, backend error) is dropped, other streams go on
+                try
+                {
+                    net.predict(frames[i], results[i], false, score);
+                }
+                catch (exception &)
+                {
+                    results[i].clear();
+                    failed[i] = true;
+                    anyFailed = true;
+                }
+            }
+
+            // Batch failed while single frames pass, so model has fixed batch size and further rounds take one frame
+            if (batchRejected && !anyFailed)
+                batchSupported = false;
+        }
+
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+        double took = chrono::duration<double>(end - begin).count();
+        double &measured = batchLatency[frames.size()];
+        measured = (measured > 0) ? 0.8 * measured + 0.2 * took : took;
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            stream &s = *batch[i];
+            double latency = chrono::duration<double>(end - s.processingCapturedAt).count();
+
+            guard.lock();
+            bool removed = s.stopped;
+            if (failed[i])
+                s.st.errors++;
+            else
+            {
+                s.st.processed++;
+                s.latencySum += latency;
+                if (latency > slo)
+                    s.st.sloMisses++;
+            }
+
+            // removeStream waits while the callback of its stream runs
+            bool deliver = !removed && !failed[i] && s.callback;
+            if (deliver)
+                callingBack = s.id;
+            guard.unlock();
+
+            if (deliver)
+            {
+                s.callback(s.id, s.processing, results[i]);
+
+                guard.lock();
+                callingBack = -1;
+                guard.unlock();
+                callbackDone.notify_all();
+            }
+        }
+
+        batch.clear();
+        guard.lock();
+    }
+}
+
+StreamScheduler::frameSource StreamScheduler::videoSource(const string &path, bool paceToFps)
+{
+    shared_ptr<cv::VideoCapture> cap = make_shared<cv::VideoCapture>(path);
+    double fps = cap->get(cv::CAP_PROP_FPS);
+    chrono::steady_clock::duration period = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>((fps > 0) ? 1.0 / fps : 0));
+    shared_ptr<chrono::steady_clock::time_point> next = make_shared<chrono::steady_clock::time_point>(chrono::steady_clock::now());
+
+    return [cap, period, next, paceToFps](cv::Mat &frame)
+    {
+        if (paceToFps && period.count() > 0)
+        {
+            this_thread::sleep_until(*next);
+            *next = max(*next + period, chrono::steady_clock::now() - period);
+        }
+        return cap->read(frame) && !frame.empty();
+    };
+}
+
+StreamScheduler::frameSource StreamScheduler::syntheticSource(cv::Size size, double fps)
+{
+    chrono::steady_clock::duration period = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>((fps > 0) ? 1.0 / fps : 0));
+    shared_ptr<chrono::steady_clock::time_point> next = make_shared<chrono::steady_clock::time_point>(chrono::steady_clock::now());
+    shared_ptr<int> index = make_shared<int>(0);
+
+    return [size, period, next, index](cv::Mat &frame)
+    {
+        if (period.count() > 0)
+        {
+            this_thread::sleep_until(*next);
+            *next += period;
+        }
+
+        frame.create(size, CV_8UC3);
+        frame.setTo(cv::Scalar(114, 114, 114));
+
+        int w = max(size.width / 6, 1), h = max(size.height / 4, 1);
+        int x = ((*index) * 4) % max(size.width - w, 1);
+        cv::rectangle(frame, cv::Rect(x, size.height / 2 - h / 2, w, h), cv::Scalar(40, 80, 200), cv::FILLED);
+        (*index)++;
+        return true;
+    };
+}
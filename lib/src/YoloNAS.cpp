@@ -2,92 +2,217 @@
 // Marked as Open Source project under GNU GPL-3.0 license
 
 #include "ukicomputers/YoloNAS.hpp"
+#include <chrono>
+
+// Timestamps of predict stages compile to nothing without YOLONAS_ENABLE_STATS
+#ifdef YOLONAS_ENABLE_STATS
+#define STATS_TIMESTAMP(name) chrono::steady_clock::time_point name = chrono::steady_clock::now()
+#define STATS_NS(from, to) (uint64_t) chrono::duration_cast<chrono::nanoseconds>(to - from).count()
+#else
+#define STATS_TIMESTAMP(name)
+#endif
 
 YoloNAS::YoloNAS(string netPath, string config, vector<string> lbls, bool cuda)
 {
-    // Load the neural network model from an ONNX file
-    try
+    InferenceBackend::options backendOptions;
+    backendOptions.cuda = cuda;
+    init(netPath, "opencv", backendOptions);
+
+    // Read and store configuration settings
+    readConfig(config);
+    labels = lbls;
+    outShape = cv::Size(cfg.width, cfg.height);
+    setupPreProcessing();
+}
+
+YoloNAS::YoloNAS(string netPath, string config, vector<string> lbls, string backendName, InferenceBackend::options backendOptions)
+{
+    init(netPath, backendName, backendOptions);
+
+    // Read and store configuration settings
+    readConfig(config);
+    labels = lbls;
+    outShape = cv::Size(cfg.width, cfg.height);
+    setupPreProcessing();
+}
+
+YoloNAS::YoloNAS(string bundlePath, string backendName, InferenceBackend::options backendOptions)
+{
+    init(bundlePath, backendName, backendOptions);
+
+    // Configuration and labels come from the bundle itself
+    readBundleConfig();
+    outShape = cv::Size(cfg.width, cfg.height);
+    setupPreProcessing();
+}
+
+void YoloNAS::init(const string &netPath, const string &backendName, const InferenceBackend::options &backendOptions)
+{
+    backend = InferenceBackend::create(backendName, backendOptions);
+    if (!backend)
     {
-        net = cv::dnn::readNetFromONNX(netPath);
+        exceptionHandler(5);
     }
-    catch (cv::Exception ex)
+
+    // Map the model once, so other contexts can be created from the same memory
+    model = make_shared<ModelBundle>();
+    switch (model->open(netPath))
     {
+    case ModelBundle::NOT_FOUND:
         exceptionHandler(0);
+    case ModelBundle::CORRUPTED:
+        exceptionHandler(6);
+    case ModelBundle::VERSION_UNSUPPORTED:
+        exceptionHandler(7);
+    default:
+        break;
     }
 
-    // Set the preferable backend and target based on CUDA availability
-    if (cuda && cv::cuda::getCudaEnabledDeviceCount() > 0)
+    loadNet();
+    statsRecorder = make_shared<StatsRecorder>();
+}
+
+void YoloNAS::loadNet()
+{
+    // Load the neural network model from ONNX file in memory
+    try
     {
-        net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
-        net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+        backend->load(model->modelData(), model->modelSize());
     }
-    else
+    catch (exception &ex)
     {
-        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        exceptionHandler(0);
     }
+}
 
-    // Read and store configuration settings
-    readConfig(config);
-    labels = lbls;
-    outShape = cv::Size(cfg.width, cfg.height);
+unique_ptr<YoloNAS> YoloNAS::clone() const
+{
+    // Configuration, labels and settings are copied, network is created again from the shared model data
+    unique_ptr<YoloNAS> context(new YoloNAS(*this));
+
+    // Copied cv::Mat members share their buffers, so every buffer written in place gets its own in the clone.
+    // Region mask is only read, and replaced (never written) when recomputed, so it stays shared.
+    context->inputBlob = cv::Mat();
+    context->outDet.clear();
+    context->dequantized.clear();
+    context->statsRecorder = make_shared<StatsRecorder>();
+    context->backend = backend->clone();
+    context->loadNet();
+
+    return context;
 }
 
 void YoloNAS::warmupModel()
 {
     cv::Mat input({1, 3, cfg.width, cfg.height}, CV_32F);
     cv::randu(input, cv::Scalar(0), cv::Scalar(1)); // fill matrix
-    net.setInput(input);
-    net.forward();
+    backend->setInput(input);
+    backend->forward(outDet);
     input.release();
 }
 
-cv::Mat YoloNAS::runPreProcessing(cv::Mat &img)
+void YoloNAS::setupPreProcessing()
 {
-    cv::Mat imgInput;
+    // Fold standardization and normalization into one affine transform per channel
+    float invStd = (cfg.std > 0) ? 1.0f / cfg.std : 1.0f;
+    float mul[3], add[3];
 
-    // Resize the image while preserving the aspect ratio
-    if (cfg.dlmr)
+    for (int c = 0; c < 3; c++)
     {
-        // Applying scale factors for only for expected MODEL input
-        float scaleX = (float)outShape.width / (float)img.cols;
-        float scaleY = (float)outShape.height / (float)img.rows;
-        int newWidth = round(img.cols * scaleX);
-        int newHeight = round(img.rows * scaleY);
-        cv::resize(img, imgInput, cv::Size(newWidth, newHeight), 0, 0, cv::INTER_LINEAR); // copying img here or down
+        mul[c] = invStd;
+        add[c] = 0;
+
+        if (cfg.norm.size() > 0)
+        {
+            mul[c] = invStd / cfg.norm[c];
+            add[c] = -cfg.norm[3 + c] * mul[c];
+        }
     }
-    else
+
+    letterbox.setNormalization(mul, add);
+
+    // Bottom right padding has priority, as center padding has nothing left to pad after it
+    if (cfg.brm > 0)
+        letterbox.setPadValue(cfg.brm);
+    else if (cfg.cp > 0)
+        letterbox.setPadValue(cfg.cp);
+}
+
+cv::Size YoloNAS::inputCanvas(cv::Size imgSize)
+{
+    if (!dynamicInput)
+        return outShape;
+
+    // Image fitted into the model size and rounded up to the stride, so wide frames get wide input instead of square one
+    float scale = min((float)outShape.width / (float)imgSize.width, (float)outShape.height / (float)imgSize.height);
+    int w = ((int)round(imgSize.width * scale) + dynamicStride - 1) / dynamicStride * dynamicStride;
+    int h = ((int)round(imgSize.height * scale) + dynamicStride - 1) / dynamicStride * dynamicStride;
+    return cv::Size(min(w, outShape.width), min(h, outShape.height));
+}
+
+void YoloNAS::setDynamicInput(bool enabled, int stride)
+{
+    dynamicInput = enabled;
+    dynamicStride = max(stride, 1);
+    if (!enabled)
+        return;
+
+    // Trial pass with 16:9 frame, models exported with fixed input shape fail here
+    cv::Mat frame(outShape.height * 9 / 16, outShape.width, CV_8UC3, cv::Scalar(0, 0, 0));
+    try
+    {
+        preprocess(frame, inputBlob);
+        infer(inputBlob, outDet);
+    }
+    catch (exception &ex)
     {
-        // Resize the input image to match the model's output shape
-        cv::resize(img, imgInput, outShape, 0, 0, cv::INTER_LINEAR);
+        dynamicInput = false;
+        exceptionHandler(9);
     }
+}
+
+void YoloNAS::letterboxGeometry(cv::Size imgSize, cv::Size canvas, cv::Size &resized, int &padLeft, int &padTop)
+{
+    resized = canvas;
 
-    // Pad sizes
-    int padHeight = outShape.width - imgInput.rows;
-    int padWidth = outShape.height - imgInput.cols;
+    // Resize the image while preserving the aspect ratio, the longest side fits the canvas
+    if (cfg.dlmr)
+    {
+        float scale = min((float)canvas.width / (float)imgSize.width, (float)canvas.height / (float)imgSize.height);
+        resized = cv::Size(min((int)round(imgSize.width * scale), canvas.width), min((int)round(imgSize.height * scale), canvas.height));
+    }
 
     // Pad detection to the bottom right or center
-    if (cfg.brm > 0)
+    padLeft = 0;
+    padTop = 0;
+    if (cfg.brm <= 0 && cfg.cp > 0)
     {
-        try
-        {
-            cv::copyMakeBorder(imgInput, imgInput, 0, padHeight, 0, padWidth, cv::BORDER_CONSTANT, cv::Scalar(cfg.brm, cfg.brm, cfg.brm));
-        }
-        catch (cv::Exception ex)
-        {
-            exceptionHandler(1);
-        }
+        padLeft = (canvas.width - resized.width) / 2;
+        padTop = (canvas.height - resized.height) / 2;
     }
+}
+
+// Reference multi pass preprocessing, used for images that are not 8-bit BGR
+cv::Mat YoloNAS::prepareImage(cv::Mat &img, cv::Size canvas)
+{
+    cv::Mat imgInput;
+
+    // Same geometry as the fused kernel
+    cv::Size resized;
+    int padLeft, padTop;
+    letterboxGeometry(img.size(), canvas, resized, padLeft, padTop);
+    cv::resize(img, imgInput, resized, 0, 0, cv::INTER_LINEAR);
 
-    // Pad detection to the center
-    if (cfg.cp > 0)
+    // Pad detection to the bottom right or center
+    int padWidth = canvas.width - resized.width;
+    int padHeight = canvas.height - resized.height;
+    if (padWidth > 0 || padHeight > 0)
     {
-        int padLeft = padWidth / 2;
-        int padTop = padHeight / 2;
+        float value = (cfg.brm > 0) ? cfg.brm : cfg.cp;
 
         try
         {
-            cv::copyMakeBorder(imgInput, imgInput, padTop, padHeight - padTop, padLeft, padWidth - padLeft, cv::BORDER_CONSTANT, cv::Scalar(cfg.cp, cfg.cp, cfg.cp));
+            cv::copyMakeBorder(imgInput, imgInput, padTop, padHeight - padTop, padLeft, padWidth - padLeft, cv::BORDER_CONSTANT, cv::Scalar(value, value, value));
         }
         catch (cv::Exception ex)
         {
@@ -95,62 +220,211 @@ cv::Mat YoloNAS::runPreProcessing(cv::Mat &img)
         }
     }
 
-    // Normalize the image if needed
+    // Normalize the image if needed (in float, so values below mean are not saturated)
     if (cfg.norm.size() > 0)
+    {
+        imgInput.convertTo(imgInput, CV_32F);
         imgInput = (imgInput - cv::Scalar(cfg.norm[3], cfg.norm[4], cfg.norm[5])) / cv::Scalar(cfg.norm[0], cfg.norm[1], cfg.norm[2]);
+    }
 
     // Standardize the image if needed
     if (cfg.std > 0)
         imgInput.convertTo(imgInput, CV_32F, 1 / cfg.std);
 
-    // Create a blob from the image
-    cv::dnn::blobFromImage(imgInput, imgInput, 1.0, cv::Size(), cv::Scalar(), true, false);
-
     return imgInput;
 }
 
-void YoloNAS::runPostProccessing(vector<vector<cv::Mat>> &input,
-                                 vector<cv::Rect> &boxesOut,
-                                 vector<int> &labelsOut,
-                                 vector<float> &scoresOut,
-                                 vector<int> &suppressedObjs,
-                                 float &scoreThresh)
+void YoloNAS::preprocessInto(cv::Mat &img, cv::Size canvas, float *dst)
 {
-    // Extract scores and bounding boxes
-    cv::Mat rawScores = input[0][0], bboxes = input[1][0];
-    rawScores = rawScores.reshape(0, {rawScores.size[1], rawScores.size[2]});
-    bboxes = bboxes.reshape(0, {bboxes.size[1], bboxes.size[2]});
-    bboxes.convertTo(bboxes, CV_32S); // convert coordinates to ints
+    size_t inputSize = 3 * canvas.area();
 
-    cv::Mat rowScores;
-    for (int i = 0; i < bboxes.size[0]; i++)
+    // Fallback to reference path for other than 8-bit BGR images
+    if (img.type() != CV_8UC3)
     {
-        double score;
-        cv::Point classID;
+        cv::Mat blob;
+        cv::dnn::blobFromImage(prepareImage(img, canvas), blob, 1.0, cv::Size(), cv::Scalar(), true, false);
+
+        if (blob.total() != inputSize)
+            exceptionHandler(1);
 
-        rowScores = rawScores.row(i);
-        cv::minMaxLoc(rowScores, 0, &score, 0, &classID);
+        memcpy(dst, blob.ptr<float>(), inputSize * sizeof(float));
+        return;
+    }
 
-        // Check if the maximum score is above the threshold
-        if ((float)score < scoreThresh)
-            continue;
+    // Resize, pad, normalize and write planar RGB in one pass
+    cv::Size resized;
+    int padLeft, padTop;
+    letterboxGeometry(img.size(), canvas, resized, padLeft, padTop);
+    letterbox.configure(img.size(), resized, canvas, padLeft, padTop);
+    letterbox.run(img, dst);
 
-        // Extract the bounding box coordinates
-        vector<int> unsizedBox{bboxes.at<int>(i, 0), bboxes.at<int>(i, 1), bboxes.at<int>(i, 2), bboxes.at<int>(i, 3)};
+#ifdef YOLONAS_VERIFY_PREPROCESSING
+    // Compare fused kernel against reference path, allowing difference of one intensity level from rounding in cv::resize
+    cv::Mat reference, fused({1, 3, canvas.height, canvas.width}, CV_32F, dst);
+    cv::dnn::blobFromImage(prepareImage(img, canvas), reference, 1.0, cv::Size(), cv::Scalar(), true, false);
+
+    float invStd = (cfg.std > 0) ? 1.0f / cfg.std : 1.0f;
+    float tolerance = invStd * 1.01f;
+    for (size_t c = 0; c < min(cfg.norm.size(), (size_t)3); c++)
+        tolerance = max(tolerance, invStd * 1.01f / abs(cfg.norm[c]));
+
+    if (cv::norm(reference, fused, cv::NORM_INF) > tolerance)
+        exceptionHandler(4);
+#endif
+}
+
+void YoloNAS::preprocess(cv::Mat &img, cv::Mat &blob)
+{
+    // Reuse the same blob, allocated only on first call or when batch size (or dynamic input shape) changes
+    cv::Size canvas = inputCanvas(img.size());
+    blob.create({1, 3, canvas.height, canvas.width}, CV_32F);
+    preprocessInto(img, canvas, blob.ptr<float>(0));
 
-        // Store the results
-        labelsOut.push_back(classID.x);
-        scoresOut.push_back(score);
-        boxesOut.push_back(cv::Rect(unsizedBox[0], unsizedBox[1], (unsizedBox[2] - unsizedBox[0]), (unsizedBox[3] - unsizedBox[1])));
+    if (!batchCanvases.empty())
+        batchCanvases.clear();
+}
+
+void YoloNAS::preprocess(const rawFrame &frame, cv::Mat &blob)
+{
+    // Buffer is read without bounds, so geometry has to be consistent before anything is touched
+    if (!frame.valid())
+        exceptionHandler(11);
+
+    cv::Size imgSize(frame.width, frame.height), canvas = inputCanvas(imgSize);
+    blob.create({1, 3, canvas.height, canvas.width}, CV_32F);
+
+    // Color conversion is fused into the letterbox pass
+    cv::Size resized;
+    int padLeft, padTop;
+    letterboxGeometry(imgSize, canvas, resized, padLeft, padTop);
+    letterbox.configure(imgSize, resized, canvas, padLeft, padTop);
+    letterbox.run(frame, blob.ptr<float>(0));
+
+    if (!batchCanvases.empty())
+        batchCanvases.clear();
+}
+
+void YoloNAS::preprocess(vector<cv::Mat> &imgs, cv::Mat &blob)
+{
+    runPreProcessing(imgs, 0, imgs.size(), blob);
+
+    // All images of one blob have the model size, also with dynamic input
+    batchCanvases.assign(imgs.size(), outShape);
+}
+
+void YoloNAS::runPreProcessing(vector<cv::Mat> &imgs, size_t first, size_t count, cv::Mat &blob)
+{
+    // Write every image directly into its place of one NCHW blob
+    blob.create({(int)count, 3, outShape.height, outShape.width}, CV_32F);
+    for (size_t i = 0; i < count; i++)
+        preprocessInto(imgs[first + i], outShape, blob.ptr<float>(i));
+}
+
+// Tiles of the same size are split between threads, each tile is letterboxed whole by one thread
+class tileBody : public cv::ParallelLoopBody
+{
+public:
+    tileBody(const FusedLetterbox &k, const cv::Mat &s, const cv::Rect *t, cv::Size ts, cv::Mat &b, int h)
+        : kernel(k), src(s), tiles(t), tileSize(ts), blob(b), canvasHeight(h) {}
+
+    void operator()(const cv::Range &range) const override
+    {
+        for (int i = range.start; i < range.end; i++)
+        {
+            if (tiles[i].size() != tileSize)
+                continue;
+
+            // ROI header only, pixels of the frame are not copied
+            cv::Mat roi = src(tiles[i]);
+            kernel.runRows(roi, blob.ptr<float>(i), 0, canvasHeight);
+        }
     }
 
-    // Apply non-maximum suppression to remove redundant detections
-    cv::dnn::NMSBoxes(boxesOut, scoresOut, scoreThresh, cfg.iou, suppressedObjs);
+private:
+    const FusedLetterbox &kernel;
+    const cv::Mat &src;
+    const cv::Rect *tiles;
+    cv::Size tileSize;
+    cv::Mat &blob;
+    int canvasHeight;
+};
+
+// Starts of tiles along one axis, last tile is aligned to the end so all of them have the same size
+static void tileStarts(int length, int tile, float overlap, vector<int> &starts)
+{
+    starts.clear();
+    if (length <= tile)
+    {
+        starts.push_back(0);
+        return;
+    }
+
+    int step = max(1, (int)(tile * (1.0f - overlap)));
+    int count = (length - tile + step - 1) / step + 1;
+    for (int i = 0; i < count; i++)
+        starts.push_back(min(i * step, length - tile));
+}
+
+void YoloNAS::computeTiles(cv::Size imgSize)
+{
+    static thread_local vector<int> xs, ys;
+    cv::Size tileSize(min(imgSize.width, outShape.width), min(imgSize.height, outShape.height));
+
+    tileStarts(imgSize.width, tileSize.width, tileOverlap, xs);
+    tileStarts(imgSize.height, tileSize.height, tileOverlap, ys);
+
+    tiles.clear();
+
+    // Whole frame pass finds objects bigger than a tile, it makes no sense when frame is a single tile
+    if (tileFullFrame && xs.size() * ys.size() > 1)
+        tiles.push_back(cv::Rect(cv::Point(0, 0), imgSize));
+
+    for (int y : ys)
+        for (int x : xs)
+            tiles.push_back(cv::Rect(cv::Point(x, y), tileSize));
+}
+
+void YoloNAS::runTilePreProcessing(cv::Mat &img, size_t first, size_t count, cv::Mat &blob)
+{
+    blob.create({(int)count, 3, outShape.height, outShape.width}, CV_32F);
+    cv::Size tileSize = tiles.back().size();
+
+    // Whole frame and images which are not 8-bit BGR go through the regular path
+    for (size_t i = 0; i < count; i++)
+    {
+        if (tiles[first + i].size() != tileSize || img.type() != CV_8UC3)
+        {
+            cv::Mat roi = img(tiles[first + i]);
+            preprocessInto(roi, outShape, blob.ptr<float>(i));
+        }
+    }
+
+    if (img.type() != CV_8UC3)
+        return;
+
+    // All tiles share the same geometry, so the kernel is configured once for the whole chunk
+    cv::Size resized;
+    int padLeft, padTop;
+    letterboxGeometry(tileSize, outShape, resized, padLeft, padTop);
+    letterbox.configure(tileSize, resized, outShape, padLeft, padTop);
+
+    cv::parallel_for_(cv::Range(0, (int)count), tileBody(letterbox, img, &tiles[first], tileSize, blob, outShape.height));
+}
+
+void YoloNAS::runPostProccessing(vector<vector<cv::Mat>> &input,
+                                 vector<cv::Rect> &boxesOut,
+                                 vector<int> &labelsOut,
+                                 vector<float> &scoresOut,
+                                 vector<int> &suppressedObjs,
+                                 float &scoreThresh,
+                                 int batchIdx)
+{
+    // Extract scores and bounding boxes of the selected image from the batch
+    cv::Mat &rawScores = input[0][0], &bboxes = input[1][0];
+    int anchors = rawScores.size[1], classes = rawScores.size[2];
 
-    // Release allocated memory
-    bboxes.release();
-    rawScores.release();
-    rowScores.release();
+    postprocessor.run(rawScores.ptr<float>(batchIdx), bboxes.ptr<float>(batchIdx), anchors, classes,
+                      scoreThresh, cfg.iou, boxesOut, labelsOut, scoresOut, suppressedObjs);
 }
 
 void YoloNAS::readConfig(string filePath)
@@ -209,6 +483,31 @@ void YoloNAS::readConfig(string filePath)
     file.close();
 }
 
+void YoloNAS::readBundleConfig()
+{
+    if (!model->isBundle())
+    {
+        exceptionHandler(2);
+    }
+
+    // Typed header replaces positional lines of metadata file
+    const ModelBundle::bundleHeader &head = model->header();
+    cfg.iou = head.iou;
+    cfg.score = head.score;
+    cfg.width = head.width;
+    cfg.height = head.height;
+    cfg.std = head.std;
+    cfg.dlmr = (head.flags & ModelBundle::FLAG_LONGEST_MAX_RESCALE) != 0;
+    cfg.brm = head.bottomRightPad;
+    cfg.cp = head.centerPad;
+
+    cfg.norm.clear();
+    if (head.flags & ModelBundle::FLAG_NORMALIZE)
+        cfg.norm.assign(head.norm, head.norm + 6);
+
+    labels = model->labels();
+}
+
 void YoloNAS::painter(cv::Mat &img, YoloNAS::detectionInfo &detection)
 {
     // Adjust the coordinates of the bounding box to the original image size
@@ -216,7 +515,11 @@ void YoloNAS::painter(cv::Mat &img, YoloNAS::detectionInfo &detection)
     cv::rectangle(img, box, cv::Scalar(139, 255, 14), 2);
 
     // Put text on detected objects to visually see what is detected
-    string text = detection.label + " - " + to_string(int(detection.score * 100)) + "%";
+    char text[128];
+    if (detection.trackId >= 0)
+        snprintf(text, sizeof(text), "%s #%d - %d%%", detection.label, detection.trackId, int(detection.score * 100));
+    else
+        snprintf(text, sizeof(text), "%s - %d%%", detection.label, int(detection.score * 100));
     cv::putText(img, text, cv::Point(detection.x, detection.y - 10), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(56, 56, 255), 2);
 }
 
@@ -231,69 +534,603 @@ void YoloNAS::exceptionHandler(int ex)
         throw runtime_error("METADATA_MISMATCHES_MODEL");
     case 2:
         throw runtime_error("METADATA_NOT_FOUND");
+    case 3:
+        throw runtime_error("MODEL_DOES_NOT_SUPPORT_BATCH");
+    case 4:
+        throw runtime_error("PREPROCESSING_MISMATCHES_REFERENCE");
+    case 5:
+        throw runtime_error("BACKEND_NOT_AVAILABLE");
+    case 6:
+        throw runtime_error("BUNDLE_CORRUPTED");
+    case 7:
+        throw runtime_error("BUNDLE_VERSION_UNSUPPORTED");
+    case 8:
+        throw runtime_error("REGION_MASK_MISMATCHES_IMAGE");
+    case 9:
+        throw runtime_error("MODEL_DOES_NOT_SUPPORT_DYNAMIC_INPUT");
+    case 10:
+        throw runtime_error("OUTPUT_QUANTIZATION_NOT_SET");
+    case 11:
+        throw runtime_error("INVALID_RAW_FRAME");
     }
 }
 
-vector<YoloNAS::detectionInfo> YoloNAS::predict(cv::Mat &img, bool applyOverlayOnImage, float scoreThresh)
+void YoloNAS::setMaxBatchSize(int size)
+{
+    maxBatchSize = max(size, 1);
+}
+
+bool YoloNAS::isQuantized()
+{
+    vector<int> depths = backend->outputDepths();
+    if (depths.empty())
+    {
+        warmupModel();
+        depths = backend->outputDepths();
+    }
+
+    for (int depth : depths)
+        if (depth != CV_32F)
+            return true;
+
+    return false;
+}
+
+void YoloNAS::setOutputQuantization(const vector<float> &scales, const vector<int> &zeroPoints)
+{
+    outScales = scales;
+    outZeroPoints = zeroPoints;
+}
+
+void YoloNAS::setTopK(int k)
+{
+    postprocessor.setTopK(k);
+}
+
+void YoloNAS::setCache(size_t capacity, int tolerance, double ttlSeconds)
+{
+    if (capacity == 0)
+        cache.reset();
+    else
+        cache = make_shared<DetectionCache>(capacity, tolerance, ttlSeconds);
+}
+
+DetectionCache::counters YoloNAS::cacheStats() const
+{
+    DetectionCache::counters none = {0, 0, 0};
+    return cache ? cache->stats() : none;
+}
+
+bool YoloNAS::cachedDecode(cv::Size imgSize, float scoreThresh, DetectionCache::hashKey &key, cv::Rect &area)
+{
+    if (!cache)
+        return false;
+
+    // Hash of the image area of the preprocessed input, so thumbnails of the same image give the same key
+    // and padding (same for every frame) does not dilute it
+    cv::Size canvas(inputBlob.size[3], inputBlob.size[2]), resized;
+    int padLeft, padTop;
+    letterboxGeometry(imgSize, canvas, resized, padLeft, padTop);
+    area = cv::Rect(padLeft, padTop, resized.width, resized.height);
+
+    key = DetectionCache::hash(inputBlob, area);
+    return cache->lookup(key, canvas, area, (scoreThresh < 0) ? cfg.score : scoreThresh, boxes, detectionLabels, scores, suppressedObjs);
+}
+
+void YoloNAS::storeDecoded(float scoreThresh, const DetectionCache::hashKey &key, cv::Rect area)
+{
+    if (!cache)
+        return;
+
+    cv::Size canvas(inputBlob.size[3], inputBlob.size[2]);
+    cache->store(key, canvas, area, (scoreThresh < 0) ? cfg.score : scoreThresh, boxes, detectionLabels, scores, suppressedObjs);
+}
+
+void YoloNAS::setClassAwareNMS(bool enabled)
+{
+    postprocessor.setClassAware(enabled);
+}
+
+void YoloNAS::collectDetections(cv::Size imgSize,
+                                cv::Size canvas,
+                                vector<cv::Rect> &boxes,
+                                vector<int> &detectionLabels,
+                                vector<float> &scores,
+                                vector<int> &suppressedObjs,
+                                vector<YoloNAS::detectionInfo> &result)
 {
-    vector<vector<cv::Mat>> outDet;
-    cv::Mat processedImg = runPreProcessing(img); // Preprocess the image
+    // Returned vector keeps its capacity between calls
+    result.clear();
+
+    // Inverse of the letterbox: padding is removed first, then resized image is scaled back to the original one
+    cv::Size resized;
+    int padLeft, padTop;
+    letterboxGeometry(imgSize, canvas, resized, padLeft, padTop);
+    float scaleX = (float)imgSize.width / (float)resized.width;
+    float scaleY = (float)imgSize.height / (float)resized.height;
+    cv::Rect imgRect(cv::Point(0, 0), imgSize);
+
+    // Return detections from result of NMS
+    for (auto i : suppressedObjs)
+    {
+        YoloNAS::detectionInfo currentDet;
+
+        // Adjust bounding box coordinates to original image size, parts lying in padding are clipped
+        cv::Rect box(int((boxes[i].x - padLeft) * scaleX), int((boxes[i].y - padTop) * scaleY),
+                     int(boxes[i].width * scaleX), int(boxes[i].height * scaleY));
+        box &= imgRect;
+
+        currentDet.x = box.x;
+        currentDet.y = box.y;
+        currentDet.w = box.width;
+        currentDet.h = box.height;
+        currentDet.score = scores[i];
+        currentDet.classId = detectionLabels[i];
+        currentDet.label = labels[detectionLabels[i]].c_str();
+        currentDet.trackId = -1;
+
+        result.push_back(currentDet);
+    }
+}
 
+void YoloNAS::infer(cv::Mat &blob, vector<vector<cv::Mat>> &outDet)
+{
     // Get raw results from inference
-    net.setInput(processedImg);
-    net.forward(outDet, net.getUnconnectedOutLayersNames());
+    backend->setInput(blob);
+    backend->forward(outDet);
 
-    // Free memory
-    processedImg.release();
+    // Postprocessing reads floats, other outputs are converted into reused buffers
+    dequantized.resize(outDet.size());
+    for (size_t i = 0; i < outDet.size(); i++)
+    {
+        cv::Mat &out = outDet[i][0];
+        if (out.depth() == CV_32F)
+            continue;
+
+        if (out.depth() == CV_16F)
+            out.convertTo(dequantized[i], CV_32F);
+        else
+        {
+            // Integer values have no meaning without scale and zero point of their output
+            if (i >= outScales.size() || i >= outZeroPoints.size())
+                exceptionHandler(10);
+            out.convertTo(dequantized[i], CV_32F, outScales[i], -outZeroPoints[i] * outScales[i]);
+        }
+        out = dequantized[i];
+    }
+}
 
+void YoloNAS::decode(vector<vector<cv::Mat>> &outDet, float scoreThresh, int batchIdx)
+{
     // Get score thresh
     if (scoreThresh < 0)
         scoreThresh = cfg.score;
 
-    // Required vectors for post processer
-    vector<float> scores;
-    vector<cv::Rect> boxes;
-    vector<int> detectionLabels, suppressedObjs;
-
     // Run result processing
-    runPostProccessing(outDet, boxes, detectionLabels, scores, suppressedObjs, scoreThresh);
+    runPostProccessing(outDet, boxes, detectionLabels, scores, suppressedObjs, scoreThresh, batchIdx);
+    decodedIdx = batchIdx;
+}
+
+vector<YoloNAS::detectionInfo> YoloNAS::rescale(cv::Size imgSize)
+{
+    vector<YoloNAS::detectionInfo> result;
+    rescale(imgSize, result);
+    return result;
+}
+
+void YoloNAS::rescale(cv::Size imgSize, vector<detectionInfo> &out)
+{
+    // Batch blob has model size even with dynamic input, single image one has canvas of the image
+    cv::Size canvas = ((size_t)decodedIdx < batchCanvases.size()) ? batchCanvases[decodedIdx] : inputCanvas(imgSize);
+    collectDetections(imgSize, canvas, boxes, detectionLabels, scores, suppressedObjs, out);
+}
 
-    // Free memory
-    outDet.clear();
+void YoloNAS::draw(cv::Mat &img, vector<detectionInfo> &detections)
+{
+    for (auto &detection : detections)
+        painter(img, detection);
+}
+
+vector<YoloNAS::detectionInfo> YoloNAS::postprocess(vector<vector<cv::Mat>> &outDet, cv::Mat &img, bool applyOverlayOnImage, float scoreThresh)
+{
+    decode(outDet, scoreThresh);
+
+    // Scale back and collect the detections
+    vector<YoloNAS::detectionInfo> result = rescale(img.size());
+
+    if (applyOverlayOnImage)
+        draw(img, result);
+
+    return result;
+}
+
+predictStats YoloNAS::stats() const
+{
+    return statsRecorder->snapshot();
+}
 
-    // Returned vector
+string YoloNAS::statsPrometheus() const
+{
+    return StatsRecorder::prometheus(stats());
+}
+
+void YoloNAS::setStatsCallback(function<void(const predictStats &)> callback)
+{
+    statsCallback = callback;
+}
+
+// Capacity of postprocessing and result vectors, its growth during predict is counted as allocated
+size_t YoloNAS::scratchBytes(const vector<detectionInfo> &out) const
+{
+    return boxes.capacity() * sizeof(cv::Rect) + scores.capacity() * sizeof(float) +
+           (detectionLabels.capacity() + suppressedObjs.capacity()) * sizeof(int) +
+           out.capacity() * sizeof(detectionInfo);
+}
+
+vector<YoloNAS::detectionInfo> YoloNAS::predict(cv::Mat &img, bool applyOverlayOnImage, float scoreThresh)
+{
     vector<YoloNAS::detectionInfo> result;
+    predict(img, result, applyOverlayOnImage, scoreThresh);
+    return result;
+}
 
-    // Applying scale factors for only for IMAGE (from already preprocessed steps)
-    float scaleX = (float)img.cols / (float)outShape.width;
-    float scaleY = (float)img.rows / (float)outShape.height;
+void YoloNAS::predict(cv::Mat &img, vector<detectionInfo> &out, bool applyOverlayOnImage, float scoreThresh)
+{
+    // All buffers are members, so after the first call of the same size library stages allocate nothing (forward and
+    // thread pool dispatch of OpenCV may)
+#ifdef YOLONAS_ENABLE_STATS
+    // Buffers are compared before and after the call to count (re)allocations
+    const uchar *blobData = inputBlob.data;
+    size_t scratchCapacity = scratchBytes(out);
+#endif
 
-    // Return detections from result of NMS
-    for (auto i : suppressedObjs)
+    STATS_TIMESTAMP(t0);
+    preprocess(img, inputBlob); // Preprocess the image
+    STATS_TIMESTAMP(t1);
+
+    // Cached frame skips forward and NMS, its result is scaled back as usual
+    DetectionCache::hashKey key;
+    cv::Rect area;
+    bool cached = cachedDecode(img.size(), scoreThresh, key, area);
+    if (!cached)
+        infer(inputBlob, outDet);
+    STATS_TIMESTAMP(t2);
+    if (!cached)
     {
-        YoloNAS::detectionInfo currentDet;
+        decode(outDet, scoreThresh);
+        storeDecoded(scoreThresh, key, area);
+    }
+    STATS_TIMESTAMP(t3);
 
-        // Adjust bounding box coordinates to original image size using scaling factors
-        currentDet.x = int(boxes[i].x * scaleX);
-        currentDet.y = int(boxes[i].y * scaleY);
-        currentDet.w = int(boxes[i].width * scaleX);
-        currentDet.h = int(boxes[i].height * scaleY);
-        currentDet.score = scores[i];
-        currentDet.label = labels[detectionLabels[i]];
+    // Scale back and collect the detections
+    rescale(img.size(), out);
+    STATS_TIMESTAMP(t4);
+
+    if (applyOverlayOnImage)
+        draw(img, out);
+    STATS_TIMESTAMP(t5);
+
+#ifdef YOLONAS_ENABLE_STATS
+    predictStats st = predictStats();
+    st.preprocessNs = STATS_NS(t0, t1);
+    st.forwardNs = STATS_NS(t1, t2);
+    st.postprocessNs = STATS_NS(t2, t3);
+    st.rescaleNs = STATS_NS(t3, t4);
+    st.painterNs = STATS_NS(t4, t5);
+    st.totalNs = STATS_NS(t0, t5);
+    st.candidates = boxes.size();
+    st.detections = out.size();
+
+    if (inputBlob.data != blobData)
+        st.bytesAllocated += inputBlob.total() * inputBlob.elemSize();
+    st.bytesAllocated += scratchBytes(out) - scratchCapacity;
+
+    statsRecorder->record(st);
+    if (statsCallback)
+        statsCallback(statsRecorder->snapshot());
+#endif
+}
+
+vector<YoloNAS::detectionInfo> YoloNAS::predict(const rawFrame &frame, float scoreThresh)
+{
+    vector<YoloNAS::detectionInfo> result;
+    predict(frame, result, scoreThresh);
+    return result;
+}
+
+void YoloNAS::predict(const rawFrame &frame, vector<detectionInfo> &out, float scoreThresh)
+{
+#ifdef YOLONAS_ENABLE_STATS
+    const uchar *blobData = inputBlob.data;
+    size_t scratchCapacity = scratchBytes(out);
+#endif
+
+    STATS_TIMESTAMP(t0);
+    preprocess(frame, inputBlob);
+    STATS_TIMESTAMP(t1);
+    DetectionCache::hashKey key;
+    cv::Rect area;
+    bool cached = cachedDecode(cv::Size(frame.width, frame.height), scoreThresh, key, area);
+    if (!cached)
+        infer(inputBlob, outDet);
+    STATS_TIMESTAMP(t2);
+    if (!cached)
+    {
+        decode(outDet, scoreThresh);
+        storeDecoded(scoreThresh, key, area);
+    }
+    STATS_TIMESTAMP(t3);
+    rescale(cv::Size(frame.width, frame.height), out);
+    STATS_TIMESTAMP(t4);
+
+#ifdef YOLONAS_ENABLE_STATS
+    predictStats st = predictStats();
+    st.preprocessNs = STATS_NS(t0, t1);
+    st.forwardNs = STATS_NS(t1, t2);
+    st.postprocessNs = STATS_NS(t2, t3);
+    st.rescaleNs = STATS_NS(t3, t4);
+    st.totalNs = STATS_NS(t0, t4);
+    st.candidates = boxes.size();
+    st.detections = out.size();
+
+    if (inputBlob.data != blobData)
+        st.bytesAllocated += inputBlob.total() * inputBlob.elemSize();
+    st.bytesAllocated += scratchBytes(out) - scratchCapacity;
+
+    statsRecorder->record(st);
+    if (statsCallback)
+        statsCallback(statsRecorder->snapshot());
+#endif
+}
+
+vector<vector<YoloNAS::detectionInfo>> YoloNAS::predictBatch(vector<cv::Mat> &imgs, bool applyOverlayOnImage, float scoreThresh)
+{
+    vector<vector<YoloNAS::detectionInfo>> results;
+    results.reserve(imgs.size());
+
+    // Get score thresh
+    if (scoreThresh < 0)
+        scoreThresh = cfg.score;
+
+    // Split images into chunks of at most maxBatchSize, each one is a single forward pass
+    for (size_t first = 0; first < imgs.size(); first += maxBatchSize)
+    {
+        size_t count = min(imgs.size() - first, (size_t)maxBatchSize);
 
-        if (applyOverlayOnImage)
+        runPreProcessing(imgs, first, count, inputBlob); // Preprocess all images of the chunk
+
+        // Get raw results from inference, models exported with fixed batch size of 1 fail here
+        try
+        {
+            infer(inputBlob, outDet);
+        }
+        catch (exception &ex)
         {
-            painter(img, currentDet);
+            exceptionHandler(3);
         }
 
-        result.push_back(currentDet);
+        // Split batched outputs back to per image detections
+        for (size_t b = 0; b < count; b++)
+        {
+            decode(outDet, scoreThresh, b);
+            results.push_back(vector<YoloNAS::detectionInfo>());
+            collectDetections(imgs[first + b].size(), outShape, boxes, detectionLabels, scores, suppressedObjs, results.back());
+
+            if (applyOverlayOnImage)
+                draw(imgs[first + b], results.back());
+        }
+    }
+
+    return results;
+}
+
+void YoloNAS::setTiling(float overlap, bool fullFrame, tileMerge merge)
+{
+    tileOverlap = min(max(overlap, 0.0f), 0.9f);
+    tileFullFrame = fullFrame;
+    tileMergeMode = merge;
+}
+
+vector<YoloNAS::detectionInfo> YoloNAS::predictTiled(cv::Mat &img, bool applyOverlayOnImage, float scoreThresh)
+{
+    vector<YoloNAS::detectionInfo> result;
+    predictTiled(img, result, applyOverlayOnImage, scoreThresh);
+    return result;
+}
+
+void YoloNAS::predictTiled(cv::Mat &img, vector<detectionInfo> &out, bool applyOverlayOnImage, float scoreThresh)
+{
+    computeTiles(img.size());
+    runTiles(img, out, scoreThresh);
+
+    if (applyOverlayOnImage)
+        draw(img, out);
+}
+
+void YoloNAS::runTiles(cv::Mat &img, vector<detectionInfo> &out, float scoreThresh)
+{
+    // Get score thresh
+    if (scoreThresh < 0)
+        scoreThresh = cfg.score;
+
+    tileBoxes.clear();
+    tileLabels.clear();
+    tileScores.clear();
+
+    size_t first = 0;
+    while (first < tiles.size())
+    {
+        size_t count = min(tiles.size() - first, batchSupported ? (size_t)maxBatchSize : (size_t)1);
+
+        runTilePreProcessing(img, first, count, inputBlob); // Preprocess all tiles of the chunk
+
+        // Models exported with fixed batch size of 1 fail here, tiles are then run one by one
+        try
+        {
+            infer(inputBlob, outDet);
+        }
+        catch (exception &ex)
+        {
+            if (count == 1)
+                throw;
+
+            batchSupported = false;
+            continue;
+        }
+
+        // Move detections of every tile to frame coordinates
+        for (size_t b = 0; b < count; b++)
+        {
+            const cv::Rect &tile = tiles[first + b];
+            decode(outDet, scoreThresh, b);
+            collectDetections(tile.size(), outShape, boxes, detectionLabels, scores, suppressedObjs, tileDetections);
+
+            for (auto &detection : tileDetections)
+            {
+                tileBoxes.push_back(cv::Rect(detection.x + tile.x, detection.y + tile.y, detection.w, detection.h));
+                tileLabels.push_back(detection.classId);
+                tileScores.push_back(detection.score);
+            }
+        }
+
+        first += count;
     }
 
-    // Free memory
-    detectionLabels.clear();
-    scores.clear();
-    boxes.clear();
-    suppressedObjs.clear();
+    // Merge duplicates across tile seams and whole frame pass, single crop has nothing to merge
+    if (tiles.size() > 1)
+        postprocessor.merge(tileBoxes, tileLabels, tileScores, cfg.iou, tileMergeMode == TILE_MERGE_WBF, tileKeep);
+    else
+    {
+        tileKeep.resize(tileBoxes.size());
+        for (size_t i = 0; i < tileKeep.size(); i++)
+            tileKeep[i] = i;
+    }
+
+    out.clear();
+    for (auto i : tileKeep)
+    {
+        YoloNAS::detectionInfo currentDet;
+        currentDet.x = tileBoxes[i].x;
+        currentDet.y = tileBoxes[i].y;
+        currentDet.w = tileBoxes[i].width;
+        currentDet.h = tileBoxes[i].height;
+        currentDet.score = tileScores[i];
+        currentDet.classId = tileLabels[i];
+        currentDet.label = labels[tileLabels[i]].c_str();
+        currentDet.trackId = -1;
+
+        out.push_back(currentDet);
+    }
+}
+
+void YoloNAS::setRegions(const vector<vector<cv::Point>> &polygons, bool separateCrops)
+{
+    // Mask is rasterized on the first frame, when its size is known
+    regionPolygons = polygons;
+    regionMask = cv::Mat();
+    regionSeparate = separateCrops;
+    regionCrops.clear();
+    regionsComputed = false;
+}
 
+void YoloNAS::setRegionMask(const cv::Mat &mask, bool separateCrops)
+{
+    if (mask.type() != CV_8UC1)
+        exceptionHandler(8);
+
+    regionPolygons.clear();
+    regionMask = mask > 0;
+    regionSeparate = separateCrops;
+    regionCrops.clear();
+    regionsComputed = false;
+}
+
+void YoloNAS::clearRegions()
+{
+    setRegions(vector<vector<cv::Point>>());
+}
+
+void YoloNAS::updateRegions(cv::Size imgSize)
+{
+    // Crops can be empty (nothing monitored in the frame), so they are not what tells whether they were computed
+    if (regionsComputed && regionsSize == imgSize)
+        return;
+
+    // Mask given directly has to match the frame, polygons are rasterized for it
+    if (regionPolygons.empty())
+    {
+        if (regionMask.size() != imgSize)
+            exceptionHandler(8);
+    }
+    else if (regionMask.size() != imgSize)
+    {
+        regionMask = cv::Mat::zeros(imgSize, CV_8U);
+        cv::fillPoly(regionMask, regionPolygons, cv::Scalar(255));
+    }
+
+    // Bounding rectangles of separate regions or of their union
+    regionCrops.clear();
+    if (regionSeparate)
+    {
+        vector<vector<cv::Point>> contours;
+        cv::findContours(regionMask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        for (auto &contour : contours)
+            regionCrops.push_back(cv::boundingRect(contour));
+    }
+    else if (cv::countNonZero(regionMask) > 0)
+        regionCrops.push_back(cv::boundingRect(regionMask));
+
+    // Crops smaller than model input are grown around their center (inside of the frame), so objects keep
+    // their scale instead of being upscaled, and network sees some context around small regions
+    for (auto &crop : regionCrops)
+    {
+        int w = max(crop.width, min(outShape.width, imgSize.width));
+        int h = max(crop.height, min(outShape.height, imgSize.height));
+        int x = min(max(crop.x + crop.width / 2 - w / 2, 0), imgSize.width - w);
+        int y = min(max(crop.y + crop.height / 2 - h / 2, 0), imgSize.height - h);
+        crop = cv::Rect(x, y, w, h);
+    }
+
+    regionsSize = imgSize;
+    regionsComputed = true;
+}
+
+vector<YoloNAS::detectionInfo> YoloNAS::predictRegions(cv::Mat &img, bool applyOverlayOnImage, float scoreThresh)
+{
+    vector<YoloNAS::detectionInfo> result;
+    predictRegions(img, result, applyOverlayOnImage, scoreThresh);
     return result;
-}
\ No newline at end of file
+}
+
+void YoloNAS::predictRegions(cv::Mat &img, vector<detectionInfo> &out, bool applyOverlayOnImage, float scoreThresh)
+{
+    // Without regions whole frame is monitored
+    if (regionPolygons.empty() && regionMask.empty())
+    {
+        predict(img, out, applyOverlayOnImage, scoreThresh);
+        return;
+    }
+
+    updateRegions(img.size());
+
+    // Nothing is monitored, network is not run at all
+    out.clear();
+    if (regionCrops.empty())
+        return;
+
+    // Crops are run the same way as tiles (same sized ones letterboxed in parallel and batched)
+    tiles.assign(regionCrops.begin(), regionCrops.end());
+    runTiles(img, out, scoreThresh);
+
+    // Keep only detections centered inside of the mask
+    out.erase(remove_if(out.begin(), out.end(), [this](const detectionInfo &detection)
+                        {
+                            int cx = min(max(detection.x + detection.w / 2, 0), regionMask.cols - 1);
+                            int cy = min(max(detection.y + detection.h / 2, 0), regionMask.rows - 1);
+                            return regionMask.at<uchar>(cy, cx) == 0;
+                        }),
+              out.end());
+
+    if (applyOverlayOnImage)
+        draw(img, out);
+}
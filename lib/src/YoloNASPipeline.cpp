@@ -0,0 +1,243 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/YoloNASPipeline.hpp"
+
+YoloNASPipeline::YoloNASPipeline(YoloNAS &detector, size_t queueSize, overflowPolicy overflow, bool applyOverlayOnImage, float scoreThresh)
+    : net(detector),
+      policy(overflow),
+      overlay(applyOverlayOnImage),
+      score(scoreThresh),
+      inputQueue(queueSize),
+      inferQueue(queueSize),
+      postQueue(queueSize),
+      accepting(true),
+      inputDone(false),
+      preprocessDone(false),
+      inferDone(false),
+      dropped(0)
+{
+    // Every stage has its own thread, as YoloNAS stages are not reentrant
+    preprocessThread = thread(&YoloNASPipeline::preprocessStage, this);
+    inferThread = thread(&YoloNASPipeline::inferStage, this);
+    postprocessThread = thread(&YoloNASPipeline::postprocessStage, this);
+}
+
+YoloNASPipeline::~YoloNASPipeline()
+{
+    stop();
+}
+
+void YoloNASPipeline::stop()
+{
+    // Submits which already passed the check finish their push first, so every accepted job is drained
+    {
+        lock_guard<mutex> guard(submitLock);
+        accepting = false;
+    }
+
+    // Stages quit one after another, once their input queue is drained
+    inputDone = true;
+
+    if (preprocessThread.joinable())
+        preprocessThread.join();
+    if (inferThread.joinable())
+        inferThread.join();
+    if (postprocessThread.joinable())
+        postprocessThread.join();
+}
+
+size_t YoloNASPipeline::droppedFrames() const
+{
+    return dropped;
+}
+
+future<vector<YoloNAS::detectionInfo>> YoloNASPipeline::submit(cv::Mat img)
+{
+    job *j = new job;
+    j->img = img;
+
+    future<vector<YoloNAS::detectionInfo>> result = j->result.get_future();
+    enqueue(j);
+
+    return result;
+}
+
+void YoloNASPipeline::submit(cv::Mat img, resultCallback callback)
+{
+    job *j = new job;
+    j->img = img;
+    j->callback = callback;
+
+    enqueue(j);
+}
+
+void YoloNASPipeline::enqueue(job *j)
+{
+    // Failed jobs are completed after the lock is released, as callback may submit again
+    vector<job *> failed;
+    bool stopped = false, full = false;
+    {
+        lock_guard<mutex> guard(submitLock);
+        if (!accepting)
+            stopped = true;
+        else if (policy == BLOCK)
+        {
+            // Callback runs on the postprocess thread, which drains the queues, so waiting there would never end
+            if (this_thread::get_id() == postprocessThread.get_id())
+                full = !inputQueue.push(j);
+            else
+                waitPush(inputQueue, j);
+        }
+        else
+        {
+            // Make space by dropping the oldest waiting frame
+            while (!inputQueue.push(j))
+            {
+                job *oldest;
+                if (inputQueue.pop(oldest))
+                {
+                    dropped++;
+                    failed.push_back(oldest);
+                }
+            }
+        }
+    }
+
+    if (stopped)
+        fail(j, make_exception_ptr(runtime_error("PIPELINE_STOPPED")));
+    else if (full)
+        fail(j, make_exception_ptr(runtime_error("QUEUE_FULL")));
+    for (auto oldest : failed)
+        fail(oldest, make_exception_ptr(runtime_error("FRAME_DROPPED")));
+}
+
+void YoloNASPipeline::fail(job *j, exception_ptr error)
+{
+    vector<YoloNAS::detectionInfo> none;
+    complete(j, none, error);
+}
+
+void YoloNASPipeline::complete(job *j, vector<YoloNAS::detectionInfo> &detections, exception_ptr error)
+{
+    if (j->callback)
+    {
+        // Exception of user callback must not stop the stage
+        try
+        {
+            j->callback(j->img, detections, error);
+        }
+        catch (...)
+        {
+        }
+    }
+    else if (error)
+        j->result.set_exception(error);
+    else
+        j->result.set_value(detections);
+
+    delete j;
+}
+
+void YoloNASPipeline::waitPush(BoundedQueue<job *> &queue, job *j)
+{
+    // Spin shortly, then back off to sleeping, so idle stages do not burn a core
+    for (int spins = 0; !queue.push(j); spins++)
+    {
+        if (spins < 64)
+            this_thread::yield();
+        else
+            this_thread::sleep_for(chrono::microseconds(100));
+    }
+}
+
+bool YoloNASPipeline::waitPop(BoundedQueue<job *> &queue, job *&j, atomic<bool> &upstreamDone)
+{
+    for (int spins = 0;; spins++)
+    {
+        if (queue.pop(j))
+            return true;
+
+        // Upstream is finished, take what is left in the queue before quitting
+        if (upstreamDone)
+            return queue.pop(j);
+
+        if (spins < 64)
+            this_thread::yield();
+        else
+            this_thread::sleep_for(chrono::microseconds(100));
+    }
+}
+
+void YoloNASPipeline::preprocessStage()
+{
+    job *j;
+    while (waitPop(inputQueue, j, inputDone))
+    {
+        try
+        {
+            net.preprocess(j->img, j->blob);
+        }
+        catch (...)
+        {
+            j->error = current_exception();
+        }
+
+        waitPush(inferQueue, j);
+    }
+
+    preprocessDone = true;
+}
+
+void YoloNASPipeline::inferStage()
+{
+    job *j;
+    while (waitPop(inferQueue, j, preprocessDone))
+    {
+        if (!j->error)
+        {
+            try
+            {
+                net.infer(j->blob, j->outDet);
+
+                // Network reuses its output memory on the next forward, which runs before this job is postprocessed
+                for (auto &layer : j->outDet)
+                    for (auto &out : layer)
+                        out = out.clone();
+            }
+            catch (...)
+            {
+                j->error = current_exception();
+            }
+        }
+
+        // Input blob is not needed anymore
+        j->blob.release();
+        waitPush(postQueue, j);
+    }
+
+    inferDone = true;
+}
+
+void YoloNASPipeline::postprocessStage()
+{
+    job *j;
+    while (waitPop(postQueue, j, inferDone))
+    {
+        vector<YoloNAS::detectionInfo> detections;
+        exception_ptr error = j->error;
+        if (!error)
+        {
+            try
+            {
+                detections = net.postprocess(j->outDet, j->img, overlay, score);
+            }
+            catch (...)
+            {
+                error = current_exception();
+            }
+        }
+
+        complete(j, detections, error);
+    }
+}
@@ -0,0 +1,348 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/YoloNASPool.hpp"
+
+// Shared by the request handle and its queued task
+struct YoloNASPool::asyncRequest::state
+{
+    atomic<bool> cancelled;
+    mutex lock;
+    bool done;
+    function<void()> continuation;
+};
+
+YoloNASPool::YoloNASPool(string netPath, string config, vector<string> lbls, size_t count, bool cuda)
+    : pending(0), queueLimit(0), running(true), nextQueue(0)
+{
+    count = max(count, (size_t)1);
+
+    // Model and metadata are read only by the first context, others are cloned from it
+    for (size_t i = 0; i < count; i++)
+    {
+        unique_ptr<context> ctx(new context);
+        ctx->net = (i == 0) ? unique_ptr<YoloNAS>(new YoloNAS(netPath, config, lbls, cuda)) : contexts[0]->net->clone();
+        ctx->jobs = 0;
+        ctx->busyNs = 0;
+        contexts.push_back(move(ctx));
+    }
+
+    created = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < count; i++)
+        contexts[i]->worker = thread(&YoloNASPool::workerLoop, this, i);
+}
+
+YoloNASPool::~YoloNASPool()
+{
+    // Workers finish queued frames before quitting
+    {
+        lock_guard<mutex> lock(sleepLock);
+        running = false;
+    }
+    wake.notify_all();
+
+    for (auto &ctx : contexts)
+        ctx->worker.join();
+}
+
+size_t YoloNASPool::size() const
+{
+    return contexts.size();
+}
+
+future<vector<YoloNAS::detectionInfo>> YoloNASPool::submit(cv::Mat img, bool applyOverlayOnImage, float scoreThresh)
+{
+    asyncOptions opts;
+    opts.applyOverlayOnImage = applyOverlayOnImage;
+    opts.scoreThresh = scoreThresh;
+
+    return move(predictAsync(img, opts).result);
+}
+
+YoloNASPool::asyncRequest YoloNASPool::predictAsync(cv::Mat img)
+{
+    return predictAsync(img, asyncOptions());
+}
+
+YoloNASPool::asyncRequest YoloNASPool::predictAsync(cv::Mat img, const asyncOptions &options)
+{
+    task *t = new task;
+    t->img = img;
+    t->opts = options;
+    t->shared = make_shared<asyncRequest::state>();
+    t->shared->cancelled = false;
+    t->shared->done = false;
+
+    asyncRequest request;
+    request.result = t->result.get_future();
+    request.shared = t->shared;
+
+    bool accepted;
+    {
+        lock_guard<mutex> lock(sleepLock);
+        accepted = queueLimit == 0 || pending < queueLimit;
+        if (accepted)
+            pending++;
+    }
+
+    // Rejected request is completed right away, on the calling thread
+    if (!accepted)
+    {
+        vector<YoloNAS::detectionInfo> none;
+        finish(t, ASYNC_QUEUE_FULL, none);
+        return request;
+    }
+
+    // Spread frames over worker queues, imbalance is fixed by stealing
+    context &ctx = *contexts[nextQueue++ % contexts.size()];
+    {
+        lock_guard<mutex> lock(ctx.queueLock);
+        ctx.tasks[t->opts.lane == PRIORITY_INTERACTIVE ? 1 : 0].push_back(t);
+    }
+
+    // All are woken, as the single woken worker could be one whose context is leased
+    wake.notify_all();
+
+    return request;
+}
+
+void YoloNASPool::setQueueLimit(size_t limit)
+{
+    lock_guard<mutex> lock(sleepLock);
+    queueLimit = limit;
+}
+
+bool YoloNASPool::takeTask(size_t idx, task *&t)
+{
+    // Interactive lane of all queues first, in each lane own queue first (oldest frame), then steal newest frame from others
+    for (int lane = PRIORITY_INTERACTIVE; lane >= PRIORITY_NORMAL; lane--)
+    {
+        for (size_t k = 0; k < contexts.size(); k++)
+        {
+            context &ctx = *contexts[(idx + k) % contexts.size()];
+            lock_guard<mutex> lock(ctx.queueLock);
+            deque<task *> &tasks = ctx.tasks[lane];
+
+            if (tasks.empty())
+                continue;
+
+            if (k == 0)
+            {
+                t = tasks.front();
+                tasks.pop_front();
+            }
+            else
+            {
+                t = tasks.back();
+                tasks.pop_back();
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void YoloNASPool::finish(task *t, asyncStatus status, vector<YoloNAS::detectionInfo> &detections, exception_ptr error)
+{
+    switch (status)
+    {
+    case ASYNC_DONE:
+        t->result.set_value(detections);
+        break;
+    case ASYNC_CANCELLED:
+        t->result.set_exception(make_exception_ptr(runtime_error("REQUEST_CANCELLED")));
+        break;
+    case ASYNC_DEADLINE_EXCEEDED:
+        t->result.set_exception(make_exception_ptr(runtime_error("DEADLINE_EXCEEDED")));
+        break;
+    case ASYNC_QUEUE_FULL:
+        t->result.set_exception(make_exception_ptr(runtime_error("QUEUE_FULL")));
+        break;
+    case ASYNC_FAILED:
+        t->result.set_exception(error);
+        break;
+    }
+
+    if (t->opts.callback)
+        t->opts.callback(status, t->img, detections);
+
+    // Continuation registered before completion is run here, later ones are refused by then
+    function<void()> continuation;
+    {
+        lock_guard<mutex> lock(t->shared->lock);
+        t->shared->done = true;
+        continuation.swap(t->shared->continuation);
+    }
+
+    delete t;
+    if (continuation)
+        continuation();
+}
+
+void YoloNASPool::workerLoop(size_t idx)
+{
+    context &ctx = *contexts[idx];
+
+    while (true)
+    {
+        // Leased context takes no work, so queued frames go to free workers instead of waiting for the lease
+        unique_lock<mutex> use(ctx.use, try_to_lock);
+        bool leased = !use.owns_lock();
+
+        task *t;
+        if (leased || !takeTask(idx, t))
+        {
+            if (!leased)
+                use.unlock();
+
+            unique_lock<mutex> lock(sleepLock);
+            if (!running && pending == 0)
+                break;
+
+            // Release of a lease is not signalled under sleepLock, so it is polled like in acquire
+            if (leased && pending > 0)
+                released.wait_for(lock, chrono::milliseconds(1));
+            else
+                wake.wait(lock, [&]
+                          { return pending > 0 || !running; });
+            continue;
+        }
+
+        {
+            lock_guard<mutex> lock(sleepLock);
+            pending--;
+        }
+
+        vector<YoloNAS::detectionInfo> detections;
+
+        // Stale and cancelled frames are dropped without running the context. Deadline is checked with the context
+        // already held, and callbacks run after it is released, so they can use the pool themselves.
+        if (t->shared->cancelled)
+        {
+            use.unlock();
+            finish(t, ASYNC_CANCELLED, detections);
+            continue;
+        }
+        if (chrono::steady_clock::now() > t->opts.deadline)
+        {
+            use.unlock();
+            finish(t, ASYNC_DEADLINE_EXCEEDED, detections);
+            continue;
+        }
+
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        exception_ptr error;
+
+        try
+        {
+            ctx.net->predict(t->img, detections, t->opts.applyOverlayOnImage, t->opts.scoreThresh);
+        }
+        catch (...)
+        {
+            error = current_exception();
+        }
+
+        ctx.jobs++;
+        ctx.busyNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count();
+        use.unlock();
+        released.notify_all();
+
+        if (error)
+        {
+            detections.clear();
+            finish(t, ASYNC_FAILED, detections, error);
+        }
+        else
+            finish(t, ASYNC_DONE, detections);
+    }
+}
+
+void YoloNASPool::asyncRequest::cancel()
+{
+    if (shared)
+        shared->cancelled = true;
+}
+
+bool YoloNASPool::asyncRequest::then(function<void()> continuation)
+{
+    if (!shared)
+        return false;
+
+    lock_guard<mutex> lock(shared->lock);
+    if (shared->done)
+        return false;
+
+    shared->continuation = continuation;
+    return true;
+}
+
+YoloNASPool::lease YoloNASPool::acquire()
+{
+    while (true)
+    {
+        for (size_t i = 0; i < contexts.size(); i++)
+        {
+            if (contexts[i]->use.try_lock())
+                return lease(this, i);
+        }
+
+        // Nothing free, wait until some context is released (timeout covers release before waiting)
+        unique_lock<mutex> lock(sleepLock);
+        released.wait_for(lock, chrono::milliseconds(1));
+    }
+}
+
+void YoloNASPool::release(size_t idx, chrono::steady_clock::time_point begin)
+{
+    context &ctx = *contexts[idx];
+    ctx.jobs++;
+    ctx.busyNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count();
+    ctx.use.unlock();
+    released.notify_all();
+}
+
+vector<YoloNASPool::contextStats> YoloNASPool::stats() const
+{
+    vector<contextStats> result;
+    double lifetime = chrono::duration<double>(chrono::steady_clock::now() - created).count();
+
+    for (auto &ctx : contexts)
+    {
+        contextStats st;
+        st.jobs = ctx->jobs;
+        st.busySeconds = ctx->busyNs / 1e9;
+        st.utilization = (lifetime > 0) ? st.busySeconds / lifetime : 0;
+        result.push_back(st);
+    }
+
+    return result;
+}
+
+YoloNASPool::lease::lease(YoloNASPool *owner, size_t idx)
+    : pool(owner), index(idx), begin(chrono::steady_clock::now())
+{
+}
+
+YoloNASPool::lease::lease(lease &&other)
+    : pool(other.pool), index(other.index), begin(other.begin)
+{
+    other.pool = nullptr;
+}
+
+YoloNASPool::lease::~lease()
+{
+    if (pool)
+        pool->release(index, begin);
+}
+
+YoloNAS &YoloNASPool::lease::operator*()
+{
+    return *pool->contexts[index]->net;
+}
+
+YoloNAS *YoloNASPool::lease::operator->()
+{
+    return pool->contexts[index]->net.get();
+}
@@ -0,0 +1,240 @@
+// YOLO-NAS CPP library written by Uglješa Lukešević (github.com/ukicomputers)
+// Marked as Open Source project under GNU GPL-3.0 license
+
+#include "ukicomputers/YoloNASStream.hpp"
+
+YoloNASStream::YoloNASStream(YoloNAS &detector, int detectEvery, float motionThresh, float scoreThresh) : net(detector)
+{
+    every = max(detectEvery, 1);
+    motion = motionThresh;
+    score = scoreThresh;
+    sinceDetection = every;
+    measurement.create(4, 1);
+}
+
+void YoloNASStream::setTracking(float iouThresh, int maxMisses)
+{
+    iou = iouThresh;
+    this->maxMisses = max(maxMisses, 0);
+}
+
+bool YoloNASStream::lastFrameDetected() const
+{
+    return detected;
+}
+
+void YoloNASStream::reset()
+{
+    tracks.clear();
+    lastGray.release();
+    sinceDetection = every;
+    nextId = 0;
+}
+
+vector<YoloNAS::detectionInfo> YoloNASStream::process(cv::Mat &frame, bool applyOverlayOnImage)
+{
+    vector<YoloNAS::detectionInfo> result;
+    process(frame, result, applyOverlayOnImage);
+    return result;
+}
+
+void YoloNASStream::process(cv::Mat &frame, vector<YoloNAS::detectionInfo> &out, bool applyOverlayOnImage)
+{
+    // Move every track by one frame
+    predictTracks(frame.size());
+
+    // Detect on the first frame, every Nth frame and when the scene moved too much since last detection
+    bool measured = false;
+    detected = ++sinceDetection >= every;
+    if (!detected && motion >= 0)
+    {
+        detected = sceneMotion(frame) > motion;
+        measured = true;
+    }
+
+    if (detected)
+    {
+        net.predictRegions(frame, detections, false, score);
+        updateTracks();
+        sinceDetection = 0;
+
+        // Keep the detected frame as reference for motion check
+        if (motion >= 0)
+        {
+            if (!measured)
+                sceneMotion(frame);
+            cv::swap(smallGray, lastGray);
+        }
+    }
+
+    // Return tracks confirmed by the last detection
+    out.clear();
+    for (auto &t : tracks)
+    {
+        if (t.misses > 0)
+            continue;
+
+        YoloNAS::detectionInfo currentDet;
+        currentDet.x = t.box.x;
+        currentDet.y = t.box.y;
+        currentDet.w = t.box.width;
+        currentDet.h = t.box.height;
+        currentDet.score = t.score;
+        currentDet.classId = t.classId;
+        currentDet.label = t.label;
+        currentDet.trackId = t.id;
+
+        out.push_back(currentDet);
+    }
+
+    if (applyOverlayOnImage)
+        net.draw(frame, out);
+}
+
+float YoloNASStream::sceneMotion(cv::Mat &frame)
+{
+    // Compare tiny grayscale copies, which is enough to notice camera or scene movement
+    int width = 64;
+    int height = max(1, frame.rows * width / max(frame.cols, 1));
+    cv::resize(frame, small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+
+    if (small.channels() == 3)
+        cv::cvtColor(small, smallGray, cv::COLOR_BGR2GRAY);
+    else
+        small.copyTo(smallGray);
+
+    if (lastGray.size() != smallGray.size())
+        return 1;
+
+    return (float)(cv::norm(smallGray, lastGray, cv::NORM_L1) / (smallGray.total() * 255.0));
+}
+
+void YoloNASStream::initTrack(track &t, const YoloNAS::detectionInfo &detection)
+{
+    t.id = nextId++;
+    t.classId = detection.classId;
+    t.label = detection.label;
+    t.score = detection.score;
+    t.misses = 0;
+    t.box = cv::Rect(detection.x, detection.y, detection.w, detection.h);
+
+    // State is center, size and their velocities per frame, measurement is center and size
+    t.kf.init(8, 4, 0, CV_32F);
+    cv::setIdentity(t.kf.transitionMatrix);
+    for (int i = 0; i < 4; i++)
+        t.kf.transitionMatrix.at<float>(i, i + 4) = 1;
+
+    cv::setIdentity(t.kf.measurementMatrix);
+    cv::setIdentity(t.kf.measurementNoiseCov, cv::Scalar::all(1));
+
+    // Velocities are unknown at the start and change slowly
+    cv::setIdentity(t.kf.processNoiseCov, cv::Scalar::all(1));
+    cv::setIdentity(t.kf.errorCovPost, cv::Scalar::all(10));
+    for (int i = 4; i < 8; i++)
+    {
+        t.kf.processNoiseCov.at<float>(i, i) = 0.01f;
+        t.kf.errorCovPost.at<float>(i, i) = 1000;
+    }
+
+    t.kf.statePost.setTo(0);
+    t.kf.statePost.at<float>(0) = detection.x + detection.w * 0.5f;
+    t.kf.statePost.at<float>(1) = detection.y + detection.h * 0.5f;
+    t.kf.statePost.at<float>(2) = (float)detection.w;
+    t.kf.statePost.at<float>(3) = (float)detection.h;
+}
+
+void YoloNASStream::predictTracks(cv::Size frameSize)
+{
+    for (auto &t : tracks)
+        t.box = stateBox(t.kf.predict(), frameSize);
+}
+
+void YoloNASStream::updateTracks()
+{
+    // Candidate pairs of the same class, matched greedily from the best overlap
+    matches.clear();
+    for (size_t ti = 0; ti < tracks.size(); ti++)
+    {
+        for (size_t di = 0; di < detections.size(); di++)
+        {
+            YoloNAS::detectionInfo &d = detections[di];
+            if (d.classId != tracks[ti].classId)
+                continue;
+
+            float o = overlap(tracks[ti].box, cv::Rect(d.x, d.y, d.w, d.h));
+            if (o >= iou)
+                matches.push_back({o, (int)ti, (int)di});
+        }
+    }
+
+    auto byOverlap = [](const match &a, const match &b)
+    {
+        return a.iou > b.iou;
+    };
+    sort(matches.begin(), matches.end(), byOverlap);
+
+    trackMatched.assign(tracks.size(), 0);
+    detectionMatched.assign(detections.size(), 0);
+
+    for (auto &m : matches)
+    {
+        if (trackMatched[m.trackIdx] || detectionMatched[m.detectionIdx])
+            continue;
+
+        trackMatched[m.trackIdx] = 1;
+        detectionMatched[m.detectionIdx] = 1;
+
+        // Correct the filter with detection, returned box is the detection itself
+        track &t = tracks[m.trackIdx];
+        YoloNAS::detectionInfo &d = detections[m.detectionIdx];
+        measurement(0) = d.x + d.w * 0.5f;
+        measurement(1) = d.y + d.h * 0.5f;
+        measurement(2) = (float)d.w;
+        measurement(3) = (float)d.h;
+        t.kf.correct(measurement);
+
+        t.box = cv::Rect(d.x, d.y, d.w, d.h);
+        t.score = d.score;
+        t.misses = 0;
+    }
+
+    // Unmatched tracks are kept for a few detection rounds, then removed
+    size_t kept = 0;
+    for (size_t ti = 0; ti < tracks.size(); ti++)
+    {
+        if (!trackMatched[ti] && ++tracks[ti].misses > maxMisses)
+            continue;
+
+        if (kept != ti)
+            tracks[kept] = move(tracks[ti]);
+        kept++;
+    }
+    tracks.resize(kept);
+
+    // Unmatched detections start new tracks
+    for (size_t di = 0; di < detections.size(); di++)
+    {
+        if (detectionMatched[di])
+            continue;
+
+        tracks.push_back(track());
+        initTrack(tracks.back(), detections[di]);
+    }
+}
+
+cv::Rect YoloNASStream::stateBox(const cv::Mat &state, cv::Size frameSize)
+{
+    float w = max(state.at<float>(2), 1.0f);
+    float h = max(state.at<float>(3), 1.0f);
+    cv::Rect box(cvRound(state.at<float>(0) - w * 0.5f), cvRound(state.at<float>(1) - h * 0.5f), cvRound(w), cvRound(h));
+
+    // Keep predicted boxes inside of the frame
+    return box & cv::Rect(cv::Point(0, 0), frameSize);
+}
+
+float YoloNASStream::overlap(const cv::Rect &a, const cv::Rect &b)
+{
+    float inter = (float)(a & b).area();
+    float uni = (float)(a.area() + b.area()) - inter;
+    return (uni > 0) ? inter / uni : 0;
+}
@@ -9,11 +9,15 @@ MODEL_TRAINED_CLASSES = (
 
 MODEL_PATH = "./model.pth"  # change this variable to your model path
 CONVERT_TO_ONNX = True  # do you want to convert that model to ONNX
+WRITE_BUNDLE = True  # do you want to write model.yolonas bundle (model, metadata and labels in one file, needs ONNX)
+MODEL_CLASS_NAMES = None  # list of class names for bundle, if None, names stored in model (or numbers) are used
 
 #################################################################################
 from super_gradients.training import models
 import super_gradients.training.processing as processing
 import numpy as np
+import struct
+import zlib
 
 std = None
 brp = None
@@ -34,6 +38,60 @@ def get_preprocessing_steps(preprocessing, processing):
     elif isinstance(preprocessing, processing.NormalizeImage):
         norm = {preprocessing.mean.toList(), std.mean.toList()}
 
+def write_bundle(path, onnx_path, iou, score, width, height, labels):
+    """
+    bundle output (version 1, little endian):
+        header (128 bytes):
+            magic "YOLONAS\\0", version, header size,
+            iou thereshold, score thereshold, width, height, standardize (0 if n),
+            flags (1 detect long max rescale, 2 normalize), bottom right padding (0 if n), center padding (0 if n),
+            std[0-2] and mean[0-2], number of labels, CRC32 of everything after header,
+            offset and size of labels, offset and size of model, CRC32 of header bytes 0..111, 12 reserved bytes
+        labels (uint32 length and bytes of every label)
+        ONNX model, aligned to 64 bytes
+    """
+    label_table = b""
+    for label in labels:
+        encoded = str(label).encode("utf-8")
+        label_table += struct.pack("<I", len(encoded)) + encoded
+
+    with open(onnx_path, "rb") as f:
+        model = f.read()
+
+    header_size = 128
+    labels_offset = header_size
+    model_offset = (labels_offset + len(label_table) + 63) // 64 * 64
+    body = label_table + b"\0" * (model_offset - labels_offset - len(label_table)) + model
+
+    flags = (1 if dlmr != None else 0) | (2 if norm != None else 0)
+    norm_values = [norm[0][0], norm[0][1], norm[0][2], norm[1][0], norm[1][1], norm[1][2]] if norm != None else [0] * 6
+
+    header = struct.pack(
+        "<8sIIffiifIff6fIIQQQQ",
+        b"YOLONAS\0",
+        1,
+        header_size,
+        iou,
+        score,
+        width,
+        height,
+        std if std != None else 0,
+        flags,
+        brp if brp != None else 0,
+        cp if cp != None else 0,
+        *norm_values,
+        len(labels),
+        zlib.crc32(body) & 0xFFFFFFFF,
+        labels_offset,
+        len(label_table),
+        model_offset,
+        len(model),
+    )
+    header += struct.pack("<I12x", zlib.crc32(header) & 0xFFFFFFFF)
+
+    with open(path, "wb") as f:
+        f.write(header + body)
+
 def main():
     global std, brp, cp, dlmr, norm
 
@@ -112,5 +170,12 @@ def main():
     if CONVERT_TO_ONNX == True:
         models.convert_to_onnx(model=net, input_shape=imgsz[1:], out_path="model.onnx")
 
+        if WRITE_BUNDLE == True:
+            labels = MODEL_CLASS_NAMES
+            if labels == None:
+                labels = getattr(net, "_class_names", None) or [str(i) for i in range(MODEL_TRAINED_CLASSES)]
+
+            write_bundle("model.yolonas", "model.onnx", net._default_nms_iou, net._default_nms_conf, imgsz[2], imgsz[3], labels)
+
 if __name__ == "__main__":
     main()
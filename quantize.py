@@ -0,0 +1,74 @@
+# Written by Uglješa Lukešević (github.com/ukicomputers)
+# Script for quantizing YOLO-NAS ONNX model to INT8 (QDQ format), used by tools/calibration
+
+MODEL_PATH = "./model.onnx"  # change this variable to your FP32 ONNX model path
+CALIBRATION_PATH = "./calibration"  # folder with preprocessed .npy inputs, written by yolonas_calibrate
+OUTPUT_PATH = "./model_int8.onnx"  # path of quantized model
+PER_CHANNEL = True  # quantize weights per output channel (more accurate, slightly slower)
+
+#################################################################################
+import argparse
+import glob
+import os
+import onnx
+import numpy as np
+from onnxruntime.quantization import (
+    CalibrationDataReader,
+    CalibrationMethod,
+    QuantFormat,
+    QuantType,
+    quantize_static,
+)
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+
+class CalibrationReader(CalibrationDataReader):
+    # Feeds preprocessed images one by one, exactly as the library feeds them to the network
+    def __init__(self, path, input_name):
+        self.files = sorted(glob.glob(os.path.join(path, "*.npy")))
+        self.input_name = input_name
+        self.index = 0
+
+    def get_next(self):
+        if self.index >= len(self.files):
+            return None
+
+        data = np.load(self.files[self.index]).astype(np.float32)
+        self.index += 1
+        return {self.input_name: data}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model", default=MODEL_PATH)
+    parser.add_argument("--calibration", default=CALIBRATION_PATH)
+    parser.add_argument("--output", default=OUTPUT_PATH)
+    args = parser.parse_args()
+
+    input_name = onnx.load(args.model).graph.input[0].name
+    reader = CalibrationReader(args.calibration, input_name)
+    if len(reader.files) == 0:
+        raise SystemExit("No calibration inputs found in " + args.calibration)
+
+    # Shape inference and graph cleanup before quantization, as recommended by ONNX Runtime
+    preprocessed = args.output + ".pre.onnx"
+    quant_pre_process(args.model, preprocessed)
+
+    # QDQ keeps DequantizeLinear in front of outputs, so the library gets float scores and boxes
+    quantize_static(
+        preprocessed,
+        args.output,
+        reader,
+        quant_format=QuantFormat.QDQ,
+        per_channel=PER_CHANNEL,
+        activation_type=QuantType.QInt8,
+        weight_type=QuantType.QInt8,
+        calibrate_method=CalibrationMethod.MinMax,
+    )
+
+    os.remove(preprocessed)
+    print("Quantized model written to " + args.output)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,9 @@
+#!/bin/bash
+
+rm -rf build
+mkdir build
+cd build
+cmake -DCMAKE_BUILD_TYPE=Release ..
+make -j$(nproc)
+
+echo -e '\nRun ./yolonas_alloccheck from build folder, no model is needed. Exit code is 1 when library stages allocate.\n'
@@ -0,0 +1,107 @@
+// Written by Uglješa Lukešević (github.com/ukicomputers)
+// Allocation check of library stages which need no model: letterbox kernel and postprocessing (decode, NMS, tile merge)
+// run on synthetic data, and heap allocations after warmup are counted. Exit code is 1 when any of them allocates.
+
+#include <ukicomputers/FusedLetterbox.hpp>
+#include <ukicomputers/Postprocessor.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+using namespace std;
+
+static atomic<size_t> allocations(0);
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *ptr = malloc(size ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+// YOLO-NAS S at 640x640 input
+const int ANCHORS = 8400, CLASSES = 80;
+const int WARMUP = 3, ITERATIONS = 50;
+
+int main()
+{
+    cv::Mat img(720, 1280, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+
+    // Letterbox 1280x720 into 640x640 (640x360 image, padded at the bottom)
+    const float mul[3] = {1 / 255.0f, 1 / 255.0f, 1 / 255.0f}, add[3] = {0, 0, 0};
+    FusedLetterbox letterbox;
+    letterbox.setNormalization(mul, add);
+    letterbox.setPadValue(114 / 255.0f);
+    letterbox.configure(img.size(), cv::Size(640, 360), cv::Size(640, 640), 0, 0);
+    vector<float> blob(3 * 640 * 640);
+
+    // Random scores with a few strong candidates per class, boxes anywhere on the canvas
+    vector<float> scores(ANCHORS * CLASSES), bboxes(ANCHORS * 4);
+    fill(scores.begin(), scores.end(), 0.01f);
+    cv::RNG rng(1);
+    for (int i = 0; i < 2000; i++)
+        scores[rng.uniform(0, ANCHORS) * CLASSES + rng.uniform(0, CLASSES)] = rng.uniform(0.3f, 1.0f);
+    for (int a = 0; a < ANCHORS; a++)
+    {
+        float x = rng.uniform(0.0f, 600.0f), y = rng.uniform(0.0f, 600.0f);
+        bboxes[a * 4] = x;
+        bboxes[a * 4 + 1] = y;
+        bboxes[a * 4 + 2] = x + rng.uniform(5.0f, 40.0f);
+        bboxes[a * 4 + 3] = y + rng.uniform(5.0f, 40.0f);
+    }
+
+    Postprocessor postprocessor;
+    vector<cv::Rect> boxes, mergeBoxes;
+    vector<int> labels, keep, mergeLabels, mergeKeep;
+    vector<float> candidateScores, mergeScores;
+
+    // Kernel rows are run on this thread, dispatch through cv::parallel_for_ is counted separately,
+    // as OpenCV thread pool may allocate its job per call depending on platform and thread count
+    size_t counts[4] = {0, 0, 0, 0};
+    for (int it = -WARMUP; it < ITERATIONS; it++)
+    {
+        size_t before[5];
+        before[0] = allocations;
+        letterbox.runRows(img, blob.data(), 0, 640);
+        before[1] = allocations;
+        letterbox.run(img, blob.data());
+        before[2] = allocations;
+        postprocessor.run(scores.data(), bboxes.data(), ANCHORS, CLASSES, 0.25f, 0.45f, boxes, labels, candidateScores, keep);
+        before[3] = allocations;
+
+        mergeBoxes.assign(boxes.begin(), boxes.end());
+        mergeLabels.assign(labels.begin(), labels.end());
+        mergeScores.assign(candidateScores.begin(), candidateScores.end());
+        postprocessor.merge(mergeBoxes, mergeLabels, mergeScores, 0.5f, true, mergeKeep);
+        before[4] = allocations;
+
+        if (it < 0)
+            continue;
+
+        for (int s = 0; s < 4; s++)
+            counts[s] += before[s + 1] - before[s];
+    }
+
+    cout << "Allocations over " << ITERATIONS << " iterations after warmup:" << endl
+         << "  letterbox kernel:   " << counts[0] << endl
+         << "  parallel dispatch:  " << counts[1] << " (cv::parallel_for_, out of library control)" << endl
+         << "  decode and NMS:     " << counts[2] << " (" << keep.size() << " detections)" << endl
+         << "  tile merge:         " << counts[3] << endl;
+
+    bool ok = counts[0] + counts[2] + counts[3] == 0;
+    cout << (ok ? "OK: library stages do not allocate" : "FAIL: library stages allocate") << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,606 @@
+// Written by Uglješa Lukešević (github.com/ukicomputers)
+// Bulk detection over archived image directories: images are decoded by parallel threads while the detector
+// runs batches, detections are written as JSON Lines or columnar binary with checkpoints to resume interrupted runs
+
+#include <ukicomputers/YoloNAS.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+using namespace std;
+
+// This is vector for already trained (by deci.ai) YOLO-NAS COCO dataset
+const vector<string> COCO_LABELS{"person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat",
+                                 "traffic light", "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat",
+                                 "dog", "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe", "backpack",
+                                 "umbrella", "handbag", "tie", "suitcase", "frisbee", "skis", "snowboard", "sports ball",
+                                 "kite", "baseball bat", "baseball glove", "skateboard", "surfboard", "tennis racket",
+                                 "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
+                                 "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair",
+                                 "couch", "potted plant", "bed", "dining table", "toilet", "tv", "laptop", "mouse",
+                                 "remote", "keyboard", "cell phone", "microwave", "oven", "toaster", "sink", "refrigerator",
+                                 "book", "clock", "vase", "scissors", "teddy bear", "hair drier", "toothbrush"};
+
+// Head directory of all models
+const string modelsPath = "../../../models/yolonas/onnx/";
+
+const vector<string> IMAGE_EXTENSIONS{".jpg", ".jpeg", ".png", ".bmp", ".webp"};
+
+struct options
+{
+    string model = modelsPath + "yolonas_s.onnx";
+    string metadata = modelsPath + "yolonas_s_metadata";
+    string bundle; // used instead of model and metadata when set
+    string labels; // file with one label per line, COCO labels by default
+    string images;
+    string output = "detections.jsonl";
+    string format = "jsonl";
+    string backend = "opencv";
+    int batch = 8;
+    int decoders = max(1, (int)thread::hardware_concurrency() / 2);
+    int window = 64; // decoded images waiting for the detector
+    int checkpointEvery = 1024;
+    float score = -1.00;
+    bool restart = false;
+};
+
+bool parseArgs(int argc, char **argv, options &opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--restart")
+        {
+            opt.restart = true;
+            continue;
+        }
+
+        if (arg == "--help" || i + 1 >= argc)
+        {
+            cout << "Usage: yolonas_batch --images dir [options]\n"
+                 << "  --images dir            directory searched recursively for images\n"
+                 << "  --model path            ONNX model\n"
+                 << "  --metadata path         metadata file\n"
+                 << "  --bundle path           model bundle (instead of model and metadata)\n"
+                 << "  --labels path           labels, one per line (COCO by default)\n"
+                 << "  --backend name          opencv, onnxruntime or openvino\n"
+                 << "  --output path           detections file\n"
+                 << "  --format name           jsonl or columnar\n"
+                 << "  --batch n               images per forward pass\n"
+                 << "  --decoders n            decoding threads\n"
+                 << "  --window n              decoded images kept ahead of the detector\n"
+                 << "  --checkpoint-every n    images between checkpoints\n"
+                 << "  --score value           score threshold (metadata one by default)\n"
+                 << "  --restart               ignore checkpoint and start from the first image\n";
+            return false;
+        }
+
+        string value = argv[++i];
+        if (arg == "--images")
+            opt.images = value;
+        else if (arg == "--model")
+            opt.model = value;
+        else if (arg == "--metadata")
+            opt.metadata = value;
+        else if (arg == "--bundle")
+            opt.bundle = value;
+        else if (arg == "--labels")
+            opt.labels = value;
+        else if (arg == "--backend")
+            opt.backend = value;
+        else if (arg == "--output")
+            opt.output = value;
+        else if (arg == "--format")
+            opt.format = value;
+        else if (arg == "--batch")
+            opt.batch = max(1, stoi(value));
+        else if (arg == "--decoders")
+            opt.decoders = max(1, stoi(value));
+        else if (arg == "--window")
+            opt.window = max(1, stoi(value));
+        else if (arg == "--checkpoint-every")
+            opt.checkpointEvery = max(1, stoi(value));
+        else if (arg == "--score")
+            opt.score = stof(value);
+    }
+    return !opt.images.empty() && (opt.format == "jsonl" || opt.format == "columnar");
+}
+
+bool isImage(const string &path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos)
+        return false;
+
+    string ext = path.substr(dot);
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return find(IMAGE_EXTENSIONS.begin(), IMAGE_EXTENSIONS.end(), ext) != IMAGE_EXTENSIONS.end();
+}
+
+// Decoded images are handed to the detector in file order, decoders may run at most window images ahead
+struct decodeQueue
+{
+    mutex lock;
+    condition_variable ready, space;
+    map<size_t, cv::Mat> decoded;
+    size_t next = 0;
+    size_t window = 0;
+    atomic<size_t> cursor;
+    atomic<bool> stop;
+};
+
+void decoderLoop(decodeQueue &q, const vector<cv::String> &files)
+{
+    while (!q.stop)
+    {
+        size_t idx = q.cursor++;
+        if (idx >= files.size())
+            break;
+
+        {
+            unique_lock<mutex> lock(q.lock);
+            q.space.wait(lock, [&]
+                         { return idx < q.next + q.window || q.stop; });
+        }
+
+        // Unreadable file is passed on as empty image, so order is kept
+        cv::Mat img = cv::imread(files[idx], cv::IMREAD_COLOR);
+
+        {
+            lock_guard<mutex> lock(q.lock);
+            q.decoded[idx] = img;
+        }
+        q.ready.notify_all();
+    }
+}
+
+cv::Mat takeDecoded(decodeQueue &q, size_t idx)
+{
+    unique_lock<mutex> lock(q.lock);
+    q.ready.wait(lock, [&]
+                 { return q.decoded.count(idx) > 0; });
+
+    cv::Mat img = q.decoded[idx];
+    q.decoded.erase(idx);
+    q.next = idx + 1;
+    lock.unlock();
+    q.space.notify_all();
+
+    return img;
+}
+
+string jsonEscape(const string &value)
+{
+    string out;
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if ((unsigned char)c < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            out += code;
+            continue;
+        }
+        out += c;
+    }
+    return out;
+}
+
+// Columnar output: magic "YNBATCH\0" followed by row groups, one per checkpoint. Row group is
+//   uint32 images, uint32 detections
+//   image columns:     uint32 pathLength[images], path bytes, int32 width[images], int32 height[images],
+//                      uint32 detectionCount[images] (width and height are 0 for unreadable files and failed predicts)
+//   detection columns: int32 x[], int32 y[], int32 w[], int32 h[], float score[], int32 classId[]
+// Labels of class ids are written to <output>.labels, one per line.
+struct rowGroup
+{
+    vector<uint32_t> pathLength, count;
+    string paths;
+    vector<int32_t> width, height;
+    vector<int32_t> x, y, w, h, classId;
+    vector<float> score;
+
+    template <typename T>
+    static void writeColumn(ofstream &out, const vector<T> &column)
+    {
+        out.write((const char *)column.data(), column.size() * sizeof(T));
+    }
+
+    void write(ofstream &out)
+    {
+        uint32_t sizes[2] = {(uint32_t)count.size(), (uint32_t)score.size()};
+        out.write((const char *)sizes, sizeof(sizes));
+
+        writeColumn(out, pathLength);
+        out.write(paths.data(), paths.size());
+        writeColumn(out, width);
+        writeColumn(out, height);
+        writeColumn(out, count);
+
+        writeColumn(out, x);
+        writeColumn(out, y);
+        writeColumn(out, w);
+        writeColumn(out, h);
+        writeColumn(out, score);
+        writeColumn(out, classId);
+    }
+
+    void clear()
+    {
+        pathLength.clear();
+        count.clear();
+        paths.clear();
+        width.clear();
+        height.clear();
+        x.clear();
+        y.clear();
+        w.clear();
+        h.clear();
+        classId.clear();
+        score.clear();
+    }
+};
+
+// FNV-1a of the sorted file list, checkpoint of a run over other files is not resumed
+uint64_t hashFiles(const vector<cv::String> &files)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (auto &file : files)
+    {
+        for (size_t i = 0; i <= file.size(); i++) // with terminating zero, so paths can not merge
+        {
+            hash ^= (unsigned char)file.c_str()[i];
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+class outputWriter
+{
+public:
+    outputWriter(const options &o, const vector<cv::String> &f) : opt(o), files(f), filesHash(hashFiles(f)), checkpointPath(o.output + ".checkpoint") {}
+
+    // Sets number of already processed images, output is truncated to its state at the last checkpoint.
+    // Returns false, with output left untouched, when checkpoint was written for other images (or can not be read)
+    // or output can not be truncated to it.
+    bool open(size_t &processed)
+    {
+        processed = 0;
+        long long bytes = 0;
+        uint64_t hash = 0;
+        string lastPath;
+
+        ifstream checkpoint(checkpointPath);
+        if (!opt.restart && checkpoint.is_open())
+        {
+            if (!(checkpoint >> processed >> bytes >> hash) || !getline(checkpoint.ignore(), lastPath) || hash != filesHash ||
+                processed == 0 || processed > files.size() || files[processed - 1] != lastPath)
+            {
+                cerr << "Checkpoint " << checkpointPath << " was written for other images, use --restart to start over" << endl;
+                return false;
+            }
+
+            // Starting over would destroy the output the checkpoint protects
+            if (truncate(opt.output.c_str(), bytes) != 0)
+            {
+                cerr << "Can not truncate " << opt.output << " to the last checkpoint (" << strerror(errno) << ")" << endl;
+                return false;
+            }
+
+            out.open(opt.output, ios::binary | ios::app);
+            readLabels();
+            return true;
+        }
+
+        processed = 0;
+        out.open(opt.output, ios::binary | ios::trunc);
+        if (opt.format == "columnar")
+            out.write("YNBATCH\0", 8);
+        return true;
+    }
+
+    bool good() const
+    {
+        return out.good();
+    }
+
+    // Error is set for images which were not predicted, they are written without size and detections
+    void add(const string &path, const cv::Mat &img, const vector<YoloNAS::detectionInfo> &detections, const char *error = nullptr)
+    {
+        int width = error ? 0 : img.cols, height = error ? 0 : img.rows;
+
+        for (auto &det : detections)
+        {
+            if ((size_t)det.classId >= labels.size())
+                labels.resize(det.classId + 1);
+            labels[det.classId] = det.label;
+        }
+
+        if (opt.format == "jsonl")
+        {
+            out << "{\"file\":\"" << jsonEscape(path) << "\",\"width\":" << width << ",\"height\":" << height;
+            if (error)
+                out << ",\"error\":\"" << error << "\"";
+
+            out << ",\"detections\":[";
+            for (size_t i = 0; i < detections.size(); i++)
+            {
+                const YoloNAS::detectionInfo &det = detections[i];
+                out << (i ? "," : "") << "{\"x\":" << det.x << ",\"y\":" << det.y << ",\"w\":" << det.w << ",\"h\":" << det.h
+                    << ",\"score\":" << det.score << ",\"class\":" << det.classId << ",\"label\":\"" << jsonEscape(det.label) << "\"}";
+            }
+            out << "]}\n";
+            return;
+        }
+
+        group.pathLength.push_back(path.size());
+        group.paths += path;
+        group.width.push_back(width);
+        group.height.push_back(height);
+        group.count.push_back(detections.size());
+        for (auto &det : detections)
+        {
+            group.x.push_back(det.x);
+            group.y.push_back(det.y);
+            group.w.push_back(det.w);
+            group.h.push_back(det.h);
+            group.score.push_back(det.score);
+            group.classId.push_back(det.classId);
+        }
+    }
+
+    // Everything written so far is flushed before checkpoint points at it, checkpoint is replaced atomically
+    void checkpoint(size_t processed)
+    {
+        if (opt.format == "columnar" && !group.count.empty())
+        {
+            group.write(out);
+            group.clear();
+        }
+        out.flush();
+
+        ofstream labelsFile(opt.output + ".labels");
+        for (auto &label : labels)
+            labelsFile << label << "\n";
+        labelsFile.close();
+
+        string tmp = checkpointPath + ".tmp";
+        ofstream file(tmp);
+        file << processed << " " << (long long)out.tellp() << " " << filesHash << "\n"
+             << files[processed - 1] << "\n";
+        file.close();
+        rename(tmp.c_str(), checkpointPath.c_str());
+    }
+
+private:
+    const options &opt;
+    const vector<cv::String> &files;
+    uint64_t filesHash;
+    string checkpointPath;
+    ofstream out;
+    rowGroup group;
+    vector<string> labels;
+
+    void readLabels()
+    {
+        ifstream file(opt.output + ".labels");
+        string line;
+        while (getline(file, line))
+            labels.push_back(line);
+    }
+};
+
+vector<string> readLabels(const string &path)
+{
+    vector<string> labels;
+    ifstream file(path);
+    string line;
+    while (getline(file, line))
+        labels.push_back(line);
+    return labels;
+}
+
+int main(int argc, char **argv)
+{
+    options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        cerr << "--images is required and --format has to be jsonl or columnar, see --help" << endl;
+        return 1;
+    }
+
+    // Sorted file list gives stable order, checkpoint is the number of processed files in it (with hash of the list)
+    vector<cv::String> all, files;
+    cv::glob(opt.images, all, true);
+    for (auto &f : all)
+        if (isImage(f))
+            files.push_back(f);
+
+    if (files.empty())
+    {
+        cerr << "No images found in " << opt.images << endl;
+        return 1;
+    }
+
+    outputWriter writer(opt, files);
+    size_t start;
+    if (!writer.open(start))
+        return 1;
+    if (!writer.good())
+    {
+        cerr << "Can not write " << opt.output << endl;
+        return 1;
+    }
+    if (start > 0)
+        cout << "Resuming after " << start << " of " << files.size() << " images" << endl;
+
+    InferenceBackend::options backendOptions;
+    unique_ptr<YoloNAS> net;
+    if (!opt.bundle.empty())
+        net.reset(new YoloNAS(opt.bundle, opt.backend, backendOptions));
+    else
+        net.reset(new YoloNAS(opt.model, opt.metadata, opt.labels.empty() ? COCO_LABELS : readLabels(opt.labels), opt.backend, backendOptions));
+
+    net->setMaxBatchSize(opt.batch);
+    net->warmupModel();
+
+    // Decoders run ahead of the detector, so reading and decoding overlaps with inference
+    decodeQueue queue;
+    queue.next = start;
+    queue.window = max(opt.window, opt.batch);
+    queue.cursor = start;
+    queue.stop = false;
+
+    vector<thread> decoders;
+    for (int i = 0; i < opt.decoders; i++)
+        decoders.push_back(thread(decoderLoop, ref(queue), cref(files)));
+
+    bool batchSupported = true;
+    size_t processed = start, sinceCheckpoint = 0, detectionsTotal = 0, failed = 0, predictFailed = 0;
+    double waitSeconds = 0, inferSeconds = 0;
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now(), lastReport = begin;
+
+    vector<cv::Mat> imgs, valid;
+    vector<size_t> validFiles;
+    vector<vector<YoloNAS::detectionInfo>> results;
+    vector<char> predictErrors;
+    vector<YoloNAS::detectionInfo> none;
+
+    while (processed < files.size())
+    {
+        size_t count = min(files.size() - processed, (size_t)opt.batch);
+
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        imgs.clear();
+        valid.clear();
+        validFiles.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            imgs.push_back(takeDecoded(queue, processed + i));
+            if (!imgs.back().empty())
+            {
+                valid.push_back(imgs.back());
+                validFiles.push_back(processed + i);
+            }
+        }
+
+        // Models with fixed batch size run image by image
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        results.clear();
+        bool batchRejected = false;
+        if (batchSupported && valid.size() > 1)
+        {
+            try
+            {
+                results = net->predictBatch(valid, false, opt.score);
+            }
+            catch (exception &ex)
+            {
+                // Other failures (bad image, transient backend error) are retried image by image for this batch only
+                batchRejected = string(ex.what()) == "MODEL_DOES_NOT_SUPPORT_BATCH";
+            }
+        }
+        predictErrors.assign(valid.size(), 0);
+        if (results.size() != valid.size())
+        {
+            // Image which fails is recorded like an unreadable one, so the run goes on (and decoders are not left running)
+            bool anyFailed = false;
+            results.assign(valid.size(), none);
+            for (size_t v = 0; v < valid.size(); v++)
+            {
+                try
+                {
+                    results[v] = net->predict(valid[v], false, opt.score);
+                }
+                catch (exception &ex)
+                {
+                    cerr << "Predict failed on " << files[validFiles[v]] << " (" << ex.what() << ")" << endl;
+                    predictErrors[v] = 1;
+                    anyFailed = true;
+                }
+            }
+
+            // Batch was rejected while single images pass, so model has fixed batch size
+            if (batchRejected && !anyFailed)
+            {
+                cerr << "Model does not support batch, running images one by one" << endl;
+                batchSupported = false;
+            }
+        }
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+        waitSeconds += chrono::duration<double>(t1 - t0).count();
+        inferSeconds += chrono::duration<double>(t2 - t1).count();
+
+        size_t r = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (imgs[i].empty())
+            {
+                failed++;
+                writer.add(files[processed + i], imgs[i], none, "DECODE_FAILED");
+                continue;
+            }
+            if (predictErrors[r])
+            {
+                predictFailed++;
+                writer.add(files[processed + i], imgs[i], none, "PREDICT_FAILED");
+                r++;
+                continue;
+            }
+
+            detectionsTotal += results[r].size();
+            writer.add(files[processed + i], imgs[i], results[r++]);
+        }
+
+        processed += count;
+        sinceCheckpoint += count;
+        if (sinceCheckpoint >= (size_t)opt.checkpointEvery || processed == files.size())
+        {
+            writer.checkpoint(processed);
+            sinceCheckpoint = 0;
+        }
+
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (chrono::duration<double>(now - lastReport).count() >= 5)
+        {
+            double elapsed = chrono::duration<double>(now - begin).count();
+            cout << processed << " / " << files.size() << " images, " << fixed << setprecision(1)
+                 << (processed - start) / elapsed << " images/s" << endl;
+            lastReport = now;
+        }
+    }
+
+    queue.stop = true;
+    queue.space.notify_all();
+    for (auto &t : decoders)
+        t.join();
+
+    size_t done = processed - start;
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    // Detector waiting for decoders means the run is I/O or decode bound, more --decoders may help
+    cout << fixed << setprecision(2) << endl
+         << "Images:             " << done << " (" << failed << " unreadable, " << predictFailed << " failed to predict)" << endl
+         << "Detections:         " << detectionsTotal << endl
+         << "Wall time:          " << elapsed << " s" << endl
+         << "Throughput:         " << (elapsed > 0 ? done / elapsed : 0) << " images/s" << endl
+         << "Inference:          " << (done ? inferSeconds * 1000 / done : 0) << " ms per image" << endl
+         << "Waiting for decode: " << (elapsed > 0 ? waitSeconds * 100 / elapsed : 0) << " % of wall time" << endl
+         << "Output:             " << opt.output << endl;
+
+    return 0;
+}
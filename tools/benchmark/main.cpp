@@ -0,0 +1,353 @@
+// Written by Uglješa Lukešević (github.com/ukicomputers)
+// Benchmark of every stage of YoloNAS::predict, reporting latency percentiles and throughput as JSON
+
+#include <ukicomputers/YoloNAS.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+using namespace std;
+
+// Counting allocator, used by --check-allocations
+static atomic<size_t> allocations(0);
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *ptr = malloc(size ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+// Labels are only needed for rescale and painter, so the count is what matters
+const vector<string> COCO_LABELS(80, "object");
+
+// Head directory of all models
+const string modelsPath = "../../../models/yolonas/onnx/";
+
+struct options
+{
+    string model = modelsPath + "yolonas_s.onnx";
+    string metadata = modelsPath + "yolonas_s_metadata";
+    string images;  // directory of recorded images, synthetic images are used if empty
+    string output = "bench.json";
+    vector<cv::Size> resolutions{cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080), cv::Size(3840, 2160)};
+    vector<int> threads{1, 0};  // 0 is backend default (all cores)
+    int interOpThreads = 0;
+    vector<int> batches{1};
+    vector<string> backends{"opencv"};
+    int iterations = 50;
+    int warmup = 5;
+    bool checkAllocations = false;
+};
+
+// Stages are timed separately, total is the whole predict
+const vector<string> STAGES{"preprocess", "forward", "postprocess", "rescale", "painter", "total"};
+
+vector<string> split(const string &value)
+{
+    vector<string> parts;
+    stringstream ss(value);
+    string part;
+    while (getline(ss, part, ','))
+        parts.push_back(part);
+    return parts;
+}
+
+bool parseArgs(int argc, char **argv, options &opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--check-allocations")
+        {
+            opt.checkAllocations = true;
+            continue;
+        }
+
+        if (arg == "--help" || i + 1 >= argc)
+        {
+            cout << "Usage: yolonas_bench [options]\n"
+                 << "  --model path          ONNX model\n"
+                 << "  --metadata path       metadata file\n"
+                 << "  --images dir          recorded images (used at their own resolution)\n"
+                 << "  --resolutions list    synthetic image sizes, e.g. 640x480,1920x1080 (empty string disables)\n"
+                 << "  --threads list        thread counts of backend and preprocessing, 0 is default\n"
+                 << "  --inter-op n          inter-op threads (onnxruntime) or streams (openvino)\n"
+                 << "  --batch list          batch sizes\n"
+                 << "  --backends list       opencv, cuda, onnxruntime, openvino (only those built into the library)\n"
+                 << "  --iterations n        measured iterations per configuration\n"
+                 << "  --warmup n            unmeasured iterations per configuration\n"
+                 << "  --output path         JSON report\n"
+                 << "  --check-allocations   count allocations of every stage after warmup, then quit\n";
+            return false;
+        }
+
+        string value = argv[++i];
+        if (arg == "--model")
+            opt.model = value;
+        else if (arg == "--metadata")
+            opt.metadata = value;
+        else if (arg == "--images")
+            opt.images = value;
+        else if (arg == "--output")
+            opt.output = value;
+        else if (arg == "--iterations")
+            opt.iterations = stoi(value);
+        else if (arg == "--warmup")
+            opt.warmup = stoi(value);
+        else if (arg == "--backends")
+            opt.backends = split(value);
+        else if (arg == "--inter-op")
+            opt.interOpThreads = stoi(value);
+        else if (arg == "--threads" || arg == "--batch")
+        {
+            vector<int> &list = (arg == "--threads") ? opt.threads : opt.batches;
+            list.clear();
+            for (auto &v : split(value))
+                list.push_back(stoi(v));
+        }
+        else if (arg == "--resolutions")
+        {
+            opt.resolutions.clear();
+            for (auto &v : split(value))
+            {
+                size_t x = v.find('x');
+                opt.resolutions.push_back(cv::Size(stoi(v.substr(0, x)), stoi(v.substr(x + 1))));
+            }
+        }
+    }
+    return true;
+}
+
+double percentile(vector<double> samples, double q)
+{
+    if (samples.empty())
+        return 0;
+
+    sort(samples.begin(), samples.end());
+    size_t idx = (size_t)ceil(q * samples.size());
+    return samples[min(max(idx, (size_t)1), samples.size()) - 1];
+}
+
+double msSince(chrono::steady_clock::time_point &begin)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double ms = chrono::duration_cast<chrono::nanoseconds>(now - begin).count() / 1e6;
+    begin = now;
+    return ms;
+}
+
+// Runs one configuration, latencies are per batch
+void runConfig(YoloNAS &net, vector<cv::Mat> &frames, int iterations, int warmup, map<string, vector<double>> &samples, double &fps)
+{
+    cv::Mat blob;
+    vector<vector<cv::Mat>> outDet;
+    double totalMs = 0;
+
+    for (int it = -warmup; it < iterations; it++)
+    {
+        // Painter draws on the frames, so draw on copies to keep inputs the same between iterations
+        vector<cv::Mat> imgs(frames.size());
+        for (size_t i = 0; i < frames.size(); i++)
+            frames[i].copyTo(imgs[i]);
+
+        map<string, double> ms;
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now(), start = begin;
+
+        if (imgs.size() == 1)
+            net.preprocess(imgs[0], blob);
+        else
+            net.preprocess(imgs, blob);
+        ms["preprocess"] = msSince(begin);
+
+        net.infer(blob, outDet);
+        ms["forward"] = msSince(begin);
+
+        for (size_t b = 0; b < imgs.size(); b++)
+        {
+            net.decode(outDet, -1, b);
+            ms["postprocess"] += msSince(begin);
+
+            vector<YoloNAS::detectionInfo> detections = net.rescale(imgs[b].size());
+            ms["rescale"] += msSince(begin);
+
+            net.draw(imgs[b], detections);
+            ms["painter"] += msSince(begin);
+        }
+
+        ms["total"] = msSince(start);
+
+        if (it < 0)
+            continue;
+
+        for (auto &st : ms)
+            samples[st.first].push_back(st.second);
+        totalMs += ms["total"];
+    }
+
+    fps = (totalMs > 0) ? iterations * frames.size() * 1000.0 / totalMs : 0;
+}
+
+// Counts heap allocations of every stage after warmup. Postprocessing and rescale are expected to make none;
+// preprocess also contains dispatch of cv::parallel_for_ (its thread pool may allocate a job per call) and forward
+// runs inside of the backend, so both are only reported. Model-free check of the kernels is tools/allocations.
+int checkAllocations(options &opt)
+{
+    YoloNAS net(opt.model, opt.metadata, COCO_LABELS, false);
+    cv::Mat img(opt.resolutions.empty() ? cv::Size(1280, 720) : opt.resolutions[0], CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+
+    cv::Mat blob;
+    vector<vector<cv::Mat>> outDet;
+    vector<YoloNAS::detectionInfo> out;
+    size_t counts[4] = {0, 0, 0, 0};
+
+    for (int it = -opt.warmup; it < opt.iterations; it++)
+    {
+        size_t before[5];
+        before[0] = allocations;
+        net.preprocess(img, blob);
+        before[1] = allocations;
+        net.infer(blob, outDet);
+        before[2] = allocations;
+        net.decode(outDet);
+        before[3] = allocations;
+        net.rescale(img.size(), out);
+        before[4] = allocations;
+
+        if (it < 0)
+            continue;
+
+        for (int s = 0; s < 4; s++)
+            counts[s] += before[s + 1] - before[s];
+    }
+
+    cout << "Allocations over " << opt.iterations << " frames after warmup:" << endl
+         << "  preprocess:  " << counts[0] << " (includes cv::parallel_for_ dispatch, depends on platform)" << endl
+         << "  forward:     " << counts[1] << " (inside OpenCV DNN, out of library control)" << endl
+         << "  postprocess: " << counts[2] << endl
+         << "  rescale:     " << counts[3] << endl;
+
+    bool ok = counts[2] + counts[3] == 0;
+    cout << (ok ? "OK: postprocessing and rescale do not allocate" : "FAIL: postprocessing or rescale allocate") << endl;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    options opt;
+    if (!parseArgs(argc, argv, opt))
+        return 0;
+
+    if (opt.checkAllocations)
+        return checkAllocations(opt);
+
+    // Inputs: synthetic noise at every resolution, and recorded images at their own resolution
+    vector<pair<string, cv::Mat>> inputs;
+    for (auto &res : opt.resolutions)
+    {
+        cv::Mat img(res, CV_8UC3);
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+        inputs.push_back(make_pair("synthetic_" + to_string(res.width) + "x" + to_string(res.height), img));
+    }
+
+    if (!opt.images.empty())
+    {
+        vector<cv::String> files;
+        cv::glob(opt.images, files);
+        for (auto &f : files)
+        {
+            cv::Mat img = cv::imread(f);
+            if (!img.empty())
+                inputs.push_back(make_pair(f, img));
+        }
+    }
+
+    ofstream json(opt.output);
+    json << "{\n  \"model\": \"" << opt.model << "\",\n  \"iterations\": " << opt.iterations << ",\n  \"results\": [";
+    bool first = true;
+
+    for (auto &backend : opt.backends)
+    {
+        for (int threads : opt.threads)
+        {
+            // Same model on every backend, threads are given to the backend and to OpenCV used for preprocessing
+            InferenceBackend::options backendOptions;
+            backendOptions.threads = threads;
+            backendOptions.interOpThreads = opt.interOpThreads;
+            backendOptions.cuda = (backend == "cuda");
+            cv::setNumThreads(threads > 0 ? threads : -1);
+
+            unique_ptr<YoloNAS> created;
+            try
+            {
+                created.reset(new YoloNAS(opt.model, opt.metadata, COCO_LABELS, backend == "cuda" ? "opencv" : backend, backendOptions));
+            }
+            catch (exception &ex)
+            {
+                cerr << backend << ": " << ex.what() << endl;
+                break;
+            }
+
+            YoloNAS &net = *created;
+            net.warmupModel();
+
+            for (int batch : opt.batches)
+            {
+                for (auto &input : inputs)
+                {
+                    vector<cv::Mat> frames(batch, input.second);
+                    map<string, vector<double>> samples;
+                    double fps;
+
+                    try
+                    {
+                        runConfig(net, frames, opt.iterations, opt.warmup, samples, fps);
+                    }
+                    catch (exception &ex)
+                    {
+                        cerr << backend << " threads=" << threads << " batch=" << batch << " " << input.first << ": " << ex.what() << endl;
+                        continue;
+                    }
+
+                    cout << backend << " threads=" << threads << " batch=" << batch << " " << input.first
+                         << ": p50 " << percentile(samples["total"], 0.5) << "ms, " << fps << " FPS" << endl;
+
+                    json << (first ? "\n" : ",\n") << "    {\"backend\": \"" << backend << "\", \"threads\": " << threads
+                         << ", \"batch\": " << batch << ", \"input\": \"" << input.first << "\", \"width\": " << input.second.cols
+                         << ", \"height\": " << input.second.rows << ", \"throughput_fps\": " << fps << ", \"stages\": {";
+                    first = false;
+
+                    for (size_t s = 0; s < STAGES.size(); s++)
+                    {
+                        vector<double> &st = samples[STAGES[s]];
+                        json << (s ? ", " : "") << "\"" << STAGES[s] << "\": {\"p50_ms\": " << percentile(st, 0.5)
+                             << ", \"p95_ms\": " << percentile(st, 0.95) << ", \"p99_ms\": " << percentile(st, 0.99) << "}";
+                    }
+                    json << "}}";
+                }
+            }
+        }
+    }
+
+    json << "\n  ]\n}\n";
+    json.close();
+
+    cout << endl << "Report written to " << opt.output << endl;
+    return 0;
+}
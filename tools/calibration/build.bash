@@ -0,0 +1,9 @@
+#!/bin/bash
+
+rm -rf build
+mkdir build
+cd build
+cmake -DCMAKE_BUILD_TYPE=Release ..
+make -j$(nproc)
+
+echo -e '\nRun ./yolonas_calibrate --help from build folder to see available options.\nquantize.py needs onnxruntime (pip install onnxruntime onnx). Download models first by executing download_models.bash in home dir of this repo.\n'
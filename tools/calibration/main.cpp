@@ -0,0 +1,291 @@
+// Written by Uglješa Lukešević (github.com/ukicomputers)
+// INT8 calibration: writes preprocessed representative images, quantizes the model with quantize.py
+// and reports accuracy, latency and memory of quantized model against FP32
+
+#include <ukicomputers/YoloNAS.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sys/stat.h>
+using namespace std;
+
+// Labels are only needed for rescale and painter, so the count is what matters
+const vector<string> COCO_LABELS(80, "object");
+
+// Head directory of all models and of the repo (quantize.py)
+const string modelsPath = "../../../models/yolonas/onnx/";
+const string repoPath = "../../../";
+
+struct options
+{
+    string model = modelsPath + "yolonas_s.onnx";
+    string metadata = modelsPath + "yolonas_s_metadata";
+    string images;
+    string calibration = "calibration";
+    string quantized = "yolonas_s_int8.onnx";
+    string script = repoPath + "quantize.py";
+    string backend = "opencv";
+    int maxImages = 200;
+    int iterations = 20;
+    bool skipQuantize = false;
+};
+
+// What quantized model gives compared to FP32
+struct comparison
+{
+    size_t reference = 0, detected = 0, matched = 0;
+    double iouSum = 0, scoreDeltaSum = 0;
+    vector<double> latency[2];
+    long rssKb[2] = {0, 0};
+};
+
+bool parseArgs(int argc, char **argv, options &opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--skip-quantize")
+        {
+            opt.skipQuantize = true;
+            continue;
+        }
+
+        if (arg == "--help" || i + 1 >= argc)
+        {
+            cout << "Usage: yolonas_calibrate --images dir [options]\n"
+                 << "  --model path          FP32 ONNX model\n"
+                 << "  --metadata path       metadata file\n"
+                 << "  --images dir          representative images\n"
+                 << "  --max-images n        images used for calibration and comparison\n"
+                 << "  --calibration dir     where preprocessed inputs are written\n"
+                 << "  --quantized path      INT8 model written by quantize.py\n"
+                 << "  --script path         quantize.py\n"
+                 << "  --skip-quantize       only compare already quantized model\n"
+                 << "  --backend name        opencv, onnxruntime or openvino\n"
+                 << "  --iterations n        timed predicts per image\n";
+            return false;
+        }
+
+        string value = argv[++i];
+        if (arg == "--model")
+            opt.model = value;
+        else if (arg == "--metadata")
+            opt.metadata = value;
+        else if (arg == "--images")
+            opt.images = value;
+        else if (arg == "--max-images")
+            opt.maxImages = stoi(value);
+        else if (arg == "--calibration")
+            opt.calibration = value;
+        else if (arg == "--quantized")
+            opt.quantized = value;
+        else if (arg == "--script")
+            opt.script = value;
+        else if (arg == "--backend")
+            opt.backend = value;
+        else if (arg == "--iterations")
+            opt.iterations = stoi(value);
+    }
+    return !opt.images.empty();
+}
+
+// Writes float NCHW blob as .npy, so quantize.py can read it with numpy
+void writeNpy(const string &path, cv::Mat &blob)
+{
+    string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (";
+    for (int d = 0; d < blob.dims; d++)
+        header += to_string(blob.size[d]) + ", ";
+    header += "), }";
+
+    // Magic, version and header length take 10 bytes, whole header is padded to 64 bytes
+    while ((10 + header.size() + 1) % 64 != 0)
+        header += ' ';
+    header += '\n';
+
+    ofstream file(path, ios::binary);
+    uint16_t headerLen = header.size();
+    file.write("\x93NUMPY\x01\x00", 8);
+    file.write((const char *)&headerLen, 2);
+    file << header;
+    file.write((const char *)blob.ptr<float>(), blob.total() * sizeof(float));
+}
+
+// Resident memory of the process in kB (Linux only, 0 elsewhere)
+long residentKb()
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            return stol(line.substr(6));
+    return 0;
+}
+
+long fileKb(const string &path)
+{
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0) ? st.st_size / 1024 : 0;
+}
+
+double percentile(vector<double> samples, double q)
+{
+    if (samples.empty())
+        return 0;
+
+    sort(samples.begin(), samples.end());
+    size_t idx = (size_t)ceil(q * samples.size());
+    return samples[min(max(idx, (size_t)1), samples.size()) - 1];
+}
+
+float iou(const YoloNAS::detectionInfo &a, const YoloNAS::detectionInfo &b)
+{
+    cv::Rect ra(a.x, a.y, a.w, a.h), rb(b.x, b.y, b.w, b.h);
+    float inter = (float)(ra & rb).area();
+    float uni = (float)(ra.area() + rb.area()) - inter;
+    return (uni > 0) ? inter / uni : 0;
+}
+
+// FP32 detections are the reference, quantized ones are matched greedily per class at IoU 0.5
+void compareDetections(vector<YoloNAS::detectionInfo> &reference, vector<YoloNAS::detectionInfo> &quantized, comparison &cmp)
+{
+    vector<char> used(quantized.size(), 0);
+    cmp.reference += reference.size();
+    cmp.detected += quantized.size();
+
+    for (auto &ref : reference)
+    {
+        int best = -1;
+        float bestIou = 0.5f;
+        for (size_t i = 0; i < quantized.size(); i++)
+        {
+            float o = iou(ref, quantized[i]);
+            if (!used[i] && quantized[i].classId == ref.classId && o >= bestIou)
+            {
+                best = i;
+                bestIou = o;
+            }
+        }
+
+        if (best < 0)
+            continue;
+
+        used[best] = 1;
+        cmp.matched++;
+        cmp.iouSum += bestIou;
+        cmp.scoreDeltaSum += abs(quantized[best].score - ref.score);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        cerr << "--images is required, see --help" << endl;
+        return 1;
+    }
+
+    // Representative images
+    vector<cv::String> files;
+    cv::glob(opt.images, files, false);
+    vector<cv::Mat> images;
+    for (auto &f : files)
+    {
+        if ((int)images.size() >= opt.maxImages)
+            break;
+
+        cv::Mat img = cv::imread(f, cv::IMREAD_COLOR);
+        if (!img.empty())
+            images.push_back(img);
+    }
+
+    if (images.empty())
+    {
+        cerr << "No images found in " << opt.images << endl;
+        return 1;
+    }
+
+    comparison cmp;
+    InferenceBackend::options backendOptions;
+
+    long before = residentKb();
+    YoloNAS reference(opt.model, opt.metadata, COCO_LABELS, opt.backend, backendOptions);
+    cmp.rssKb[0] = residentKb() - before;
+
+    // Calibration inputs go through the same preprocessing as inference, one image per file
+    if (!opt.skipQuantize)
+    {
+        mkdir(opt.calibration.c_str(), 0755);
+
+        cv::Mat blob;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            vector<cv::Mat> one{images[i]};
+            reference.preprocess(one, blob);
+
+            char name[32];
+            snprintf(name, sizeof(name), "/%05zu.npy", i);
+            writeNpy(opt.calibration + name, blob);
+        }
+        cout << "Calibration inputs written to " << opt.calibration << " (" << images.size() << " images)" << endl;
+
+        string command = "python3 \"" + opt.script + "\" --model \"" + opt.model + "\" --calibration \"" + opt.calibration + "\" --output \"" + opt.quantized + "\"";
+        if (system(command.c_str()) != 0)
+        {
+            cerr << "Quantization failed: " << command << endl;
+            return 1;
+        }
+    }
+
+    before = residentKb();
+    YoloNAS quantized(opt.quantized, opt.metadata, COCO_LABELS, opt.backend, backendOptions);
+    cmp.rssKb[1] = residentKb() - before;
+
+    // QDQ models of quantize.py end with DequantizeLinear, integer outputs would need setOutputQuantization
+    if (quantized.isQuantized())
+        cerr << "Warning: " << opt.quantized << " has outputs of other type than float" << endl;
+
+    reference.warmupModel();
+    quantized.warmupModel();
+
+    // Run every image through both models
+    YoloNAS *nets[2] = {&reference, &quantized};
+    vector<YoloNAS::detectionInfo> detections[2];
+    for (auto &img : images)
+    {
+        for (int n = 0; n < 2; n++)
+        {
+            for (int it = 0; it < opt.iterations; it++)
+            {
+                chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+                nets[n]->predict(img, detections[n], false);
+                cmp.latency[n].push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count() / 1e6);
+            }
+        }
+
+        compareDetections(detections[0], detections[1], cmp);
+    }
+
+    double recall = cmp.reference ? (double)cmp.matched / cmp.reference : 1;
+    double precision = cmp.detected ? (double)cmp.matched / cmp.detected : 1;
+    double p50[2] = {percentile(cmp.latency[0], 0.5), percentile(cmp.latency[1], 0.5)};
+
+    cout << fixed << setprecision(3) << endl
+         << "Accuracy against FP32 (" << images.size() << " images, " << cmp.reference << " reference detections)" << endl
+         << "  recall:            " << recall << endl
+         << "  precision:         " << precision << endl
+         << "  mean IoU:          " << (cmp.matched ? cmp.iouSum / cmp.matched : 0) << endl
+         << "  mean score delta:  " << (cmp.matched ? cmp.scoreDeltaSum / cmp.matched : 0) << endl
+         << "Latency of predict (p50 / p95 ms)" << endl
+         << "  FP32:              " << p50[0] << " / " << percentile(cmp.latency[0], 0.95) << endl
+         << "  INT8:              " << p50[1] << " / " << percentile(cmp.latency[1], 0.95) << endl
+         << "  speedup:           " << (p50[1] > 0 ? p50[0] / p50[1] : 0) << "x" << endl
+         << "Memory" << endl
+         << "  model file:        " << fileKb(opt.model) << " kB -> " << fileKb(opt.quantized) << " kB" << endl
+         << "  resident on load:  " << cmp.rssKb[0] << " kB -> " << cmp.rssKb[1] << " kB" << endl;
+
+    return 0;
+}
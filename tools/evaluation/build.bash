@@ -0,0 +1,9 @@
+#!/bin/bash
+
+rm -rf build
+mkdir build
+cd build
+cmake -DCMAKE_BUILD_TYPE=Release ..
+make -j$(nproc)
+
+echo -e '\nRun ./yolonas_eval --help from build folder to see available options.\nDownload models first by executing download_models.bash in home dir of this repo.\n'
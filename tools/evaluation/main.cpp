@@ -0,0 +1,508 @@
+// Written by Uglješa Lukešević (github.com/ukicomputers)
+// Accuracy and performance regression check: runs the detector over COCO-format dataset, computes mAP@0.5:0.95
+// like pycocotools, measures throughput and latency, and fails when any of them regresses against baseline JSON
+
+#include <ukicomputers/YoloNAS.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+using namespace std;
+
+// This is vector for already trained (by deci.ai) YOLO-NAS COCO dataset, names match COCO 2017 categories
+const vector<string> COCO_LABELS{"person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat",
+                                 "traffic light", "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat",
+                                 "dog", "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe", "backpack",
+                                 "umbrella", "handbag", "tie", "suitcase", "frisbee", "skis", "snowboard", "sports ball",
+                                 "kite", "baseball bat", "baseball glove", "skateboard", "surfboard", "tennis racket",
+                                 "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
+                                 "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair",
+                                 "couch", "potted plant", "bed", "dining table", "toilet", "tv", "laptop", "mouse",
+                                 "remote", "keyboard", "cell phone", "microwave", "oven", "toaster", "sink", "refrigerator",
+                                 "book", "clock", "vase", "scissors", "teddy bear", "hair drier", "toothbrush"};
+
+// Head directory of all models
+const string modelsPath = "../../../models/yolonas/onnx/";
+
+struct options
+{
+    string model = modelsPath + "yolonas_s.onnx";
+    string metadata = modelsPath + "yolonas_s_metadata";
+    string bundle; // used instead of model and metadata when set
+    string labels; // file with one label per line, COCO labels by default
+    string images;
+    string annotations;
+    string output = "eval.json";
+    string baseline;
+    string backend = "opencv";
+    int maxImages = 0; // 0 evaluates all images
+    int warmup = 5;
+    float score = 0.001f; // mAP needs low-score detections too, as in the reference COCO evaluation
+    double mapTolerance = 0.005; // absolute drop of mAP
+    double perfTolerance = 0.10; // relative drop of throughput or rise of latency
+};
+
+bool parseArgs(int argc, char **argv, options &opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc)
+        {
+            cout << "Usage: yolonas_eval --images dir --annotations instances.json [options]\n"
+                 << "  --images dir            directory with images of the annotations\n"
+                 << "  --annotations path      COCO-format annotations JSON\n"
+                 << "  --model path            ONNX model\n"
+                 << "  --metadata path         metadata file\n"
+                 << "  --bundle path           model bundle (instead of model and metadata)\n"
+                 << "  --labels path           labels, one per line (COCO by default)\n"
+                 << "  --backend name          opencv, onnxruntime or openvino\n"
+                 << "  --output path           results JSON, can be used as baseline of later runs\n"
+                 << "  --baseline path         results JSON of earlier run, regression fails with exit code 2,\n"
+                 << "                          missing images with exit code 3\n"
+                 << "  --map-tolerance value   allowed absolute drop of mAP (0.005)\n"
+                 << "  --perf-tolerance value  allowed relative drop of throughput or rise of latency (0.10)\n"
+                 << "  --max-images n          evaluate only first n images\n"
+                 << "  --warmup n              predictions before measuring\n"
+                 << "  --score value           score threshold (0.001)\n";
+            return false;
+        }
+
+        string value = argv[++i];
+        if (arg == "--images")
+            opt.images = value;
+        else if (arg == "--annotations")
+            opt.annotations = value;
+        else if (arg == "--model")
+            opt.model = value;
+        else if (arg == "--metadata")
+            opt.metadata = value;
+        else if (arg == "--bundle")
+            opt.bundle = value;
+        else if (arg == "--labels")
+            opt.labels = value;
+        else if (arg == "--backend")
+            opt.backend = value;
+        else if (arg == "--output")
+            opt.output = value;
+        else if (arg == "--baseline")
+            opt.baseline = value;
+        else if (arg == "--map-tolerance")
+            opt.mapTolerance = stod(value);
+        else if (arg == "--perf-tolerance")
+            opt.perfTolerance = stod(value);
+        else if (arg == "--max-images")
+            opt.maxImages = max(0, stoi(value));
+        else if (arg == "--warmup")
+            opt.warmup = max(0, stoi(value));
+        else if (arg == "--score")
+            opt.score = stof(value);
+    }
+    return !opt.images.empty() && !opt.annotations.empty();
+}
+
+vector<string> readLabels(const string &path)
+{
+    vector<string> labels;
+    ifstream file(path);
+    string line;
+    while (getline(file, line))
+        labels.push_back(line);
+    return labels;
+}
+
+struct box
+{
+    double x, y, w, h;
+};
+
+struct groundTruth
+{
+    box b;
+    int category;
+    bool crowd;
+};
+
+struct detection
+{
+    box b;
+    int category;
+    double score;
+};
+
+struct imageInfo
+{
+    int id;
+    string file;
+    vector<groundTruth> truths;
+    vector<detection> detections;
+    bool loaded = false; // image was found and predicted
+};
+
+struct dataset
+{
+    vector<imageInfo> images;
+    vector<int> categoryIds;       // sorted, index is the model class id when labels do not match names
+    map<string, int> categoryByName;
+};
+
+bool loadAnnotations(const string &path, dataset &data)
+{
+    cv::FileStorage fs(path, cv::FileStorage::READ | cv::FileStorage::FORMAT_JSON);
+    if (!fs.isOpened())
+        return false;
+
+    map<int, size_t> imageIndex;
+    for (auto node : fs["images"])
+    {
+        imageInfo image;
+        image.id = (int)node["id"];
+        image.file = (string)node["file_name"];
+        imageIndex[image.id] = data.images.size();
+        data.images.push_back(image);
+    }
+
+    for (auto node : fs["categories"])
+    {
+        data.categoryIds.push_back((int)node["id"]);
+        data.categoryByName[(string)node["name"]] = (int)node["id"];
+    }
+    sort(data.categoryIds.begin(), data.categoryIds.end());
+
+    for (auto node : fs["annotations"])
+    {
+        auto it = imageIndex.find((int)node["image_id"]);
+        if (it == imageIndex.end())
+            continue;
+
+        cv::FileNode bbox = node["bbox"];
+        groundTruth truth;
+        truth.b = {(double)bbox[0], (double)bbox[1], (double)bbox[2], (double)bbox[3]};
+        truth.category = (int)node["category_id"];
+        truth.crowd = !node["iscrowd"].empty() && (int)node["iscrowd"] != 0;
+        data.images[it->second].truths.push_back(truth);
+    }
+
+    return !data.images.empty();
+}
+
+// Detections of crowd regions are matched by the share of detection inside of the region
+double iou(const box &d, const box &g, bool crowd)
+{
+    double w = min(d.x + d.w, g.x + g.w) - max(d.x, g.x);
+    double h = min(d.y + d.h, g.y + g.h) - max(d.y, g.y);
+    if (w <= 0 || h <= 0)
+        return 0;
+
+    double inter = w * h;
+    double uni = crowd ? d.w * d.h : d.w * d.h + g.w * g.h - inter;
+    return uni > 0 ? inter / uni : 0;
+}
+
+// Evaluation follows pycocotools (area "all", 100 detections per image): greedy matching by score per image,
+// precision made monotonic and sampled at 101 recall points, averaged over categories and IoU thresholds 0.5:0.05:0.95
+struct accuracy
+{
+    double map, map50, map75;
+};
+
+accuracy evaluate(const dataset &data)
+{
+    const int thresholds = 10, recallPoints = 101, maxDetections = 100;
+
+    // ap[t] collects AP of every category with ground truth
+    vector<vector<double>> ap(thresholds);
+
+    struct scored
+    {
+        double score;
+        bool matched, ignored;
+    };
+
+    for (int category : data.categoryIds)
+    {
+        for (int t = 0; t < thresholds; t++)
+        {
+            double threshold = 0.5 + 0.05 * t;
+            vector<scored> all;
+            size_t positives = 0;
+
+            for (auto &image : data.images)
+            {
+                // Non-crowd truths first, so they are preferred over crowd regions
+                vector<const groundTruth *> truths;
+                for (auto &truth : image.truths)
+                    if (truth.category == category && !truth.crowd)
+                        truths.push_back(&truth);
+                positives += truths.size();
+                size_t plain = truths.size();
+                for (auto &truth : image.truths)
+                    if (truth.category == category && truth.crowd)
+                        truths.push_back(&truth);
+
+                vector<const detection *> dets;
+                for (auto &det : image.detections)
+                    if (det.category == category)
+                        dets.push_back(&det);
+                stable_sort(dets.begin(), dets.end(), [](const detection *a, const detection *b)
+                            { return a->score > b->score; });
+                if (dets.size() > (size_t)maxDetections)
+                    dets.resize(maxDetections);
+
+                vector<bool> taken(truths.size(), false);
+                for (auto det : dets)
+                {
+                    double best = min(threshold, 1 - 1e-10);
+                    int match = -1;
+                    for (size_t g = 0; g < truths.size(); g++)
+                    {
+                        // Crowd regions can match many detections, and are only tried when no plain truth matched
+                        if (taken[g] && !truths[g]->crowd)
+                            continue;
+                        if (match >= 0 && (size_t)match < plain && g >= plain)
+                            break;
+
+                        double overlap = iou(det->b, truths[g]->b, truths[g]->crowd);
+                        if (overlap < best)
+                            continue;
+                        best = overlap;
+                        match = g;
+                    }
+
+                    if (match >= 0)
+                        taken[match] = true;
+                    all.push_back({det->score, match >= 0, match >= 0 && (size_t)match >= plain});
+                }
+            }
+
+            if (positives == 0)
+                continue;
+
+            stable_sort(all.begin(), all.end(), [](const scored &a, const scored &b)
+                        { return a.score > b.score; });
+
+            vector<double> recall, precision;
+            double tp = 0, fp = 0;
+            for (auto &s : all)
+            {
+                if (s.ignored)
+                    continue;
+                (s.matched ? tp : fp) += 1;
+                recall.push_back(tp / positives);
+                precision.push_back(tp / (tp + fp));
+            }
+
+            for (size_t i = precision.size(); i-- > 1;)
+                precision[i - 1] = max(precision[i - 1], precision[i]);
+
+            double sum = 0;
+            for (int r = 0; r < recallPoints; r++)
+            {
+                double point = (double)r / (recallPoints - 1);
+                size_t idx = lower_bound(recall.begin(), recall.end(), point) - recall.begin();
+                if (idx < precision.size())
+                    sum += precision[idx];
+            }
+            ap[t].push_back(sum / recallPoints);
+        }
+    }
+
+    auto mean = [](const vector<double> &values)
+    {
+        double sum = 0;
+        for (double v : values)
+            sum += v;
+        return values.empty() ? 0 : sum / values.size();
+    };
+
+    accuracy acc;
+    vector<double> means;
+    for (int t = 0; t < thresholds; t++)
+        means.push_back(mean(ap[t]));
+    acc.map = mean(means);
+    acc.map50 = means[0];
+    acc.map75 = means[5];
+    return acc;
+}
+
+double percentile(vector<double> samples, double q)
+{
+    if (samples.empty())
+        return 0;
+
+    sort(samples.begin(), samples.end());
+    size_t idx = (size_t)ceil(q * samples.size());
+    return samples[min(max(idx, (size_t)1), samples.size()) - 1];
+}
+
+struct results
+{
+    size_t images;
+    accuracy acc;
+    double throughput, p50, p95;
+};
+
+void writeResults(const string &path, const string &model, const results &r)
+{
+    ofstream json(path);
+    json << fixed << setprecision(6)
+         << "{\n  \"model\": \"" << model << "\",\n  \"images\": " << r.images
+         << ",\n  \"map\": " << r.acc.map << ",\n  \"map50\": " << r.acc.map50 << ",\n  \"map75\": " << r.acc.map75
+         << ",\n  \"throughput\": " << r.throughput << ",\n  \"latency_p50_ms\": " << r.p50
+         << ",\n  \"latency_p95_ms\": " << r.p95 << "\n}\n";
+}
+
+// Compares against baseline, prints every check and returns false when any of them regressed
+bool compareBaseline(const options &opt, const results &r)
+{
+    cv::FileStorage fs(opt.baseline, cv::FileStorage::READ | cv::FileStorage::FORMAT_JSON);
+    if (!fs.isOpened())
+    {
+        cerr << "Can not read baseline " << opt.baseline << endl;
+        return false;
+    }
+
+    if ((int)fs["images"] != (int)r.images)
+        cout << "Warning: baseline was measured on " << (int)fs["images"] << " images" << endl;
+
+    struct check
+    {
+        string name;
+        double current, base;
+        bool failed;
+    };
+
+    double map = (double)fs["map"], throughput = (double)fs["throughput"], p95 = (double)fs["latency_p95_ms"];
+    vector<check> checks{
+        {"mAP@0.5:0.95", r.acc.map, map, r.acc.map < map - opt.mapTolerance},
+        {"Throughput", r.throughput, throughput, r.throughput < throughput * (1 - opt.perfTolerance)},
+        {"Latency p95", r.p95, p95, r.p95 > p95 * (1 + opt.perfTolerance)}};
+
+    bool passed = true;
+    cout << endl;
+    for (auto &c : checks)
+    {
+        cout << left << setw(14) << c.name << right << c.current << " (baseline " << c.base << ")"
+             << (c.failed ? "  REGRESSION" : "  ok") << endl;
+        passed = passed && !c.failed;
+    }
+    return passed;
+}
+
+int main(int argc, char **argv)
+{
+    options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        cerr << "--images and --annotations are required, see --help" << endl;
+        return 1;
+    }
+
+    dataset data;
+    if (!loadAnnotations(opt.annotations, data))
+    {
+        cerr << "Can not read annotations " << opt.annotations << endl;
+        return 1;
+    }
+    if (opt.maxImages > 0 && data.images.size() > (size_t)opt.maxImages)
+        data.images.resize(opt.maxImages);
+
+    vector<string> labels = opt.labels.empty() ? COCO_LABELS : readLabels(opt.labels);
+
+    InferenceBackend::options backendOptions;
+    unique_ptr<YoloNAS> net;
+    if (!opt.bundle.empty())
+        net.reset(new YoloNAS(opt.bundle, opt.backend, backendOptions));
+    else
+        net.reset(new YoloNAS(opt.model, opt.metadata, labels, opt.backend, backendOptions));
+    net->warmupModel();
+
+    // Model class id maps to category of the same name, or to category of the same index in sorted ids
+    auto categoryOf = [&](const YoloNAS::detectionInfo &det)
+    {
+        auto it = data.categoryByName.find(det.label);
+        if (it != data.categoryByName.end())
+            return it->second;
+        return ((size_t)det.classId < data.categoryIds.size()) ? data.categoryIds[det.classId] : -1;
+    };
+
+    // Decoding is not timed, latency covers the whole predict of one image
+    vector<double> latencies;
+    vector<YoloNAS::detectionInfo> out;
+    size_t missing = 0;
+    int warmup = opt.warmup;
+    for (size_t i = 0; i < data.images.size(); i++)
+    {
+        imageInfo &image = data.images[i];
+        cv::Mat img = cv::imread(opt.images + "/" + image.file, cv::IMREAD_COLOR);
+        if (img.empty())
+        {
+            missing++;
+            continue;
+        }
+
+        for (; warmup > 0; warmup--)
+            net->predict(img, out, false, opt.score);
+
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        net->predict(img, out, false, opt.score);
+        latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count());
+
+        for (auto &det : out)
+            image.detections.push_back({{(double)det.x, (double)det.y, (double)det.w, (double)det.h}, categoryOf(det), det.score});
+        image.loaded = true;
+
+        if ((i + 1) % 500 == 0)
+            cout << i + 1 << " / " << data.images.size() << " images" << endl;
+    }
+
+    if (latencies.empty())
+    {
+        cerr << "No images of the annotations found in " << opt.images << endl;
+        return 1;
+    }
+
+    // Ground truth of missing images would count as missed detections, so they are left out of mAP
+    data.images.erase(remove_if(data.images.begin(), data.images.end(), [](const imageInfo &image)
+                                { return !image.loaded; }),
+                      data.images.end());
+
+    results r;
+    r.images = latencies.size();
+    r.acc = evaluate(data);
+    double total = 0;
+    for (double l : latencies)
+        total += l;
+    r.throughput = r.images * 1000 / total;
+    r.p50 = percentile(latencies, 0.5);
+    r.p95 = percentile(latencies, 0.95);
+
+    cout << fixed << setprecision(4) << endl
+         << "Images:        " << r.images << " (" << missing << " missing)" << endl
+         << "mAP@0.5:0.95:  " << r.acc.map << endl
+         << "mAP@0.5:       " << r.acc.map50 << endl
+         << "mAP@0.75:      " << r.acc.map75 << endl
+         << setprecision(2)
+         << "Throughput:    " << r.throughput << " images/s" << endl
+         << "Latency p50:   " << r.p50 << " ms" << endl
+         << "Latency p95:   " << r.p95 << " ms" << endl;
+
+    writeResults(opt.output, opt.bundle.empty() ? opt.model : opt.bundle, r);
+
+    if (!opt.baseline.empty() && !compareBaseline(opt, r))
+    {
+        cerr << "Regression against " << opt.baseline << endl;
+        return 2;
+    }
+
+    // Result over a subset of the dataset is not comparable with the baseline
+    if (!opt.baseline.empty() && missing > 0)
+    {
+        cerr << missing << " images of the annotations are missing in " << opt.images << endl;
+        return 3;
+    }
+    return 0;
+}